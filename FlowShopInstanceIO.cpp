@@ -0,0 +1,400 @@
+#pragma once
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <istream>
+#include <limits>
+#include <ostream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include "FlowShopParallel.cpp"
+
+#if defined(_WIN32)
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace flowshop_ext {
+
+// ---------- Binary instance files ----------
+// Version 1 layout, all fields in the writer's native byte order (the header
+// carries a marker so a file from the other endianness is rejected):
+//
+//   header   char magic[4] = "FSIB", uint32 version = 1,
+//            uint64 count (instances), uint64 byteOrder = 0x0102030405060708
+//   record   uint32 n, uint32 m, int64 U,
+//            int64 p[n], int64 w[n], int64 u[n]          (one per instance)
+//
+// Everything is 8-byte aligned, so a mapped file is read in place: a
+// record's p / w / u arrays are used directly as SoA columns. Jobs get ids
+// 0..n-1 in file order. U and every u must fit in an int (the solvers' type).
+namespace instance_file {
+
+constexpr char kMagic[4] = {'F', 'S', 'I', 'B'};
+constexpr std::uint32_t kVersion = 1;
+constexpr std::uint64_t kByteOrder = 0x0102030405060708ULL;
+
+struct Header {
+    char magic[4];
+    std::uint32_t version;
+    std::uint64_t count;
+    std::uint64_t byteOrder;
+};
+
+struct RecordHeader {
+    std::uint32_t n;
+    std::uint32_t m;
+    std::int64_t U;
+};
+
+static_assert(sizeof(Header) == 24, "instance file header must be 24 bytes");
+static_assert(sizeof(RecordHeader) == 16, "instance record header must be 16 bytes");
+
+inline void checkHeader(const Header& h) {
+    if (std::memcmp(h.magic, kMagic, sizeof(kMagic)) != 0) {
+        throw std::runtime_error("not a flowshop instance file (bad magic)");
+    }
+    if (h.byteOrder != kByteOrder) {
+        throw std::runtime_error("instance file was written with a different byte order");
+    }
+    if (h.version != kVersion) {
+        throw std::runtime_error("unsupported instance file version " + std::to_string(h.version));
+    }
+}
+
+inline std::uint64_t recordBytes(std::uint32_t n) {
+    return sizeof(RecordHeader) + 3ULL * n * sizeof(std::int64_t);
+}
+
+} // namespace instance_file
+
+// One instance inside a mapped file (pointers into the mapping, no copy).
+struct InstanceView {
+    int n = 0;
+    int m = 0;
+    int U = 0;
+    const std::int64_t* p = nullptr;
+    const std::int64_t* w = nullptr;
+    const std::int64_t* u = nullptr;
+};
+
+// Fill `out` from a view, reusing its vectors' capacity.
+inline void loadInstance(const InstanceView& view, OutsourcingInstance& out) {
+    out.m = view.m;
+    out.U = view.U;
+    out.jobs.resize(view.n);
+    out.ui.resize(view.n);
+    for (int i = 0; i < view.n; ++i) {
+        out.jobs[i] = flowshop::Job{i, view.p[i], view.w[i]};
+        out.ui[i] = static_cast<int>(view.u[i]);
+    }
+}
+
+// Read-only mapping of a whole instance file. Opening checks the header and
+// walks the record headers once to index them (and to validate every size
+// against the file length); instance(k) is then O(1) and copies nothing.
+class MappedInstanceFile {
+public:
+    explicit MappedInstanceFile(const std::string& path) {
+        map(path);
+        try {
+            index();
+        } catch (...) {
+            unmap();
+            throw;
+        }
+    }
+
+    ~MappedInstanceFile() { unmap(); }
+
+    MappedInstanceFile(const MappedInstanceFile&) = delete;
+    MappedInstanceFile& operator=(const MappedInstanceFile&) = delete;
+
+    size_t size() const { return offsets_.size(); }
+
+    InstanceView instance(size_t k) const {
+        if (k >= offsets_.size()) throw std::out_of_range("instance index out of range");
+        const unsigned char* at = data_ + offsets_[k];
+        instance_file::RecordHeader rec;
+        std::memcpy(&rec, at, sizeof(rec));
+
+        InstanceView view;
+        view.n = static_cast<int>(rec.n);
+        view.m = static_cast<int>(rec.m);
+        view.U = static_cast<int>(rec.U);
+        view.p = reinterpret_cast<const std::int64_t*>(at + sizeof(rec));
+        view.w = view.p + rec.n;
+        view.u = view.w + rec.n;
+        return view;
+    }
+
+private:
+    void index() {
+        using namespace instance_file;
+        if (size_ < sizeof(Header)) throw std::runtime_error("instance file too short");
+        Header header;
+        std::memcpy(&header, data_, sizeof(header));
+        checkHeader(header);
+
+        const std::uint64_t maxInt = static_cast<std::uint64_t>(std::numeric_limits<int>::max());
+        offsets_.reserve(static_cast<size_t>(std::min<std::uint64_t>(header.count, size_ / sizeof(RecordHeader))));
+        size_t offset = sizeof(Header);
+        for (std::uint64_t k = 0; k < header.count; ++k) {
+            if (size_ - offset < sizeof(RecordHeader)) throw std::runtime_error("instance file truncated");
+            RecordHeader rec;
+            std::memcpy(&rec, data_ + offset, sizeof(rec));
+            if (rec.n > maxInt || rec.m == 0 || rec.m > maxInt || rec.U < 0 ||
+                static_cast<std::uint64_t>(rec.U) > maxInt) {
+                throw std::runtime_error("instance file record " + std::to_string(k) + " is invalid");
+            }
+            const std::uint64_t bytes = recordBytes(rec.n);
+            if (size_ - offset < bytes) throw std::runtime_error("instance file truncated");
+
+            const auto* u = reinterpret_cast<const std::int64_t*>(data_ + offset + sizeof(rec)) + 2ULL * rec.n;
+            for (std::uint32_t i = 0; i < rec.n; ++i) {
+                if (u[i] < 0 || static_cast<std::uint64_t>(u[i]) > maxInt) {
+                    throw std::runtime_error("instance file record " + std::to_string(k) + " has an invalid u");
+                }
+            }
+            offsets_.push_back(offset);
+            offset += static_cast<size_t>(bytes);
+        }
+    }
+
+#if defined(_WIN32)
+    void map(const std::string& path) {
+        file_ = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr,
+                            OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+        if (file_ == INVALID_HANDLE_VALUE) throw std::runtime_error("cannot open " + path);
+        LARGE_INTEGER length;
+        if (!GetFileSizeEx(file_, &length)) {
+            unmap();
+            throw std::runtime_error("cannot stat " + path);
+        }
+        size_ = static_cast<size_t>(length.QuadPart);
+        if (size_ == 0) return;
+        mapping_ = CreateFileMappingA(file_, nullptr, PAGE_READONLY, 0, 0, nullptr);
+        if (mapping_) {
+            data_ = static_cast<const unsigned char*>(MapViewOfFile(mapping_, FILE_MAP_READ, 0, 0, 0));
+        }
+        if (!data_) {
+            unmap();
+            throw std::runtime_error("cannot map " + path);
+        }
+    }
+
+    void unmap() {
+        if (data_) UnmapViewOfFile(data_);
+        if (mapping_) CloseHandle(mapping_);
+        if (file_ != INVALID_HANDLE_VALUE) CloseHandle(file_);
+        data_ = nullptr;
+        mapping_ = nullptr;
+        file_ = INVALID_HANDLE_VALUE;
+    }
+
+    HANDLE file_ = INVALID_HANDLE_VALUE;
+    HANDLE mapping_ = nullptr;
+#else
+    void map(const std::string& path) {
+        const int fd = ::open(path.c_str(), O_RDONLY);
+        if (fd < 0) throw std::runtime_error("cannot open " + path);
+        struct stat st;
+        if (fstat(fd, &st) != 0) {
+            ::close(fd);
+            throw std::runtime_error("cannot stat " + path);
+        }
+        size_ = static_cast<size_t>(st.st_size);
+        if (size_ > 0) {
+            void* p = mmap(nullptr, size_, PROT_READ, MAP_SHARED, fd, 0);
+            if (p == MAP_FAILED) {
+                ::close(fd);
+                throw std::runtime_error("cannot map " + path);
+            }
+            data_ = static_cast<const unsigned char*>(p);
+        }
+        ::close(fd);   // the mapping stays valid
+    }
+
+    void unmap() {
+        if (data_) munmap(const_cast<unsigned char*>(data_), size_);
+        data_ = nullptr;
+    }
+#endif
+
+    const unsigned char* data_ = nullptr;
+    size_t size_ = 0;
+    std::vector<size_t> offsets_;
+};
+
+// Writes instances one at a time; the count in the header is patched by
+// close() (or the destructor), so the number need not be known up front.
+class InstanceFileWriter {
+public:
+    explicit InstanceFileWriter(const std::string& path)
+        : out_(path, std::ios::binary | std::ios::trunc) {
+        if (!out_) throw std::runtime_error("cannot create " + path);
+        instance_file::Header header;
+        std::memcpy(header.magic, instance_file::kMagic, sizeof(header.magic));
+        header.version = instance_file::kVersion;
+        header.count = 0;
+        header.byteOrder = instance_file::kByteOrder;
+        out_.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    }
+
+    ~InstanceFileWriter() {
+        try {
+            close();
+        } catch (...) {
+        }
+    }
+
+    InstanceFileWriter(const InstanceFileWriter&) = delete;
+    InstanceFileWriter& operator=(const InstanceFileWriter&) = delete;
+
+    void write(const OutsourcingInstance& inst) {
+        if (!out_.is_open()) throw std::logic_error("InstanceFileWriter is closed");
+        const size_t n = inst.jobs.size();
+        if (inst.ui.size() != n) throw std::invalid_argument("outsourcingCosts size must match allJobs size");
+        if (inst.m <= 0) throw std::invalid_argument("m must be positive");
+        if (inst.U < 0) throw std::invalid_argument("U must be non-negative");
+        if (n > static_cast<size_t>(std::numeric_limits<int>::max())) {
+            throw std::invalid_argument("too many jobs for an instance file record");
+        }
+        // Everything is checked before the first byte goes out, so a rejected
+        // instance leaves no partial record behind.
+        for (size_t i = 0; i < n; ++i) {
+            if (inst.ui[i] < 0) throw std::invalid_argument("outsourcingCosts must be non-negative");
+        }
+
+        instance_file::RecordHeader rec{static_cast<std::uint32_t>(n), static_cast<std::uint32_t>(inst.m), inst.U};
+        out_.write(reinterpret_cast<const char*>(&rec), sizeof(rec));
+
+        column_.resize(n);
+        for (size_t i = 0; i < n; ++i) column_[i] = inst.jobs[i].p;
+        writeColumn();
+        for (size_t i = 0; i < n; ++i) column_[i] = inst.jobs[i].w;
+        writeColumn();
+        for (size_t i = 0; i < n; ++i) column_[i] = inst.ui[i];
+        writeColumn();
+        ++count_;
+    }
+
+    std::uint64_t count() const { return count_; }
+
+    void close() {
+        if (!out_.is_open()) return;
+        out_.seekp(offsetof(instance_file::Header, count));
+        out_.write(reinterpret_cast<const char*>(&count_), sizeof(count_));
+        out_.close();
+        if (out_.fail()) throw std::runtime_error("writing the instance file failed");
+    }
+
+private:
+    void writeColumn() {
+        out_.write(reinterpret_cast<const char*>(column_.data()),
+                   static_cast<std::streamsize>(column_.size() * sizeof(std::int64_t)));
+    }
+
+    std::ofstream out_;
+    std::vector<std::int64_t> column_;
+    std::uint64_t count_ = 0;
+};
+
+// Sequential reader for any std::istream (pipes, files too large to map):
+// one record at a time into the caller's instance, reusing its capacity and
+// one column buffer, so memory stays O(largest n) for any number of instances.
+class InstanceStreamReader {
+public:
+    explicit InstanceStreamReader(std::istream& in) : in_(in) {
+        instance_file::Header header;
+        readExactly(&header, sizeof(header));
+        instance_file::checkHeader(header);
+        remaining_ = header.count;
+    }
+
+    // Instances not read yet.
+    std::uint64_t remaining() const { return remaining_; }
+
+    // False once every instance is read.
+    bool next(OutsourcingInstance& out) {
+        if (remaining_ == 0) return false;
+        instance_file::RecordHeader rec;
+        readExactly(&rec, sizeof(rec));
+        const std::uint64_t maxInt = static_cast<std::uint64_t>(std::numeric_limits<int>::max());
+        if (rec.n > maxInt || rec.m == 0 || rec.m > maxInt || rec.U < 0 ||
+            static_cast<std::uint64_t>(rec.U) > maxInt) {
+            throw std::runtime_error("instance stream has an invalid record");
+        }
+
+        // n is not checked against anything yet: buffers are sized only
+        // after the p column has actually arrived (see readColumn).
+        const size_t n = rec.n;
+        out.m = static_cast<int>(rec.m);
+        out.U = static_cast<int>(rec.U);
+
+        readColumn(n);
+        out.jobs.resize(n);
+        for (size_t i = 0; i < n; ++i) out.jobs[i] = flowshop::Job{static_cast<int>(i), column_[i], 0};
+        readColumn(n);
+        for (size_t i = 0; i < n; ++i) out.jobs[i].w = column_[i];
+        readColumn(n);
+        out.ui.resize(n);
+        for (size_t i = 0; i < n; ++i) {
+            if (column_[i] < 0 || static_cast<std::uint64_t>(column_[i]) > maxInt) {
+                throw std::runtime_error("instance stream has an invalid u");
+            }
+            out.ui[i] = static_cast<int>(column_[i]);
+        }
+        --remaining_;
+        return true;
+    }
+
+private:
+    void readExactly(void* dst, size_t bytes) {
+        in_.read(static_cast<char*>(dst), static_cast<std::streamsize>(bytes));
+        if (in_.gcount() != static_cast<std::streamsize>(bytes)) {
+            throw std::runtime_error("instance stream truncated");
+        }
+    }
+
+    // n values into column_, in chunks of at most kColumnChunk: a stream that
+    // claims a huge n but ends early throws "truncated" having grown the
+    // buffer only by what it delivered, instead of allocating n up front.
+    void readColumn(size_t n) {
+        constexpr size_t kColumnChunk = size_t{1} << 16;
+        column_.clear();
+        while (column_.size() < n) {
+            const size_t have = column_.size();
+            const size_t chunk = std::min(kColumnChunk, n - have);
+            column_.resize(have + chunk);
+            readExactly(column_.data() + have, chunk * sizeof(std::int64_t));
+        }
+    }
+
+    std::istream& in_;
+    std::vector<std::int64_t> column_;
+    std::uint64_t remaining_ = 0;
+};
+
+// Every instance of a mapped file through the batch API, in file order.
+inline std::vector<NaiveResult> solveBatch(BatchSolver& batch, const MappedInstanceFile& file,
+                                           BatchAlgorithm algorithm = BatchAlgorithm::DP) {
+    return batch.solveEach(file.size(), [&file](size_t k, OutsourcingInstance& inst) {
+        loadInstance(file.instance(k), inst);
+    }, algorithm);
+}
+
+} // namespace flowshop_ext
@@ -0,0 +1,393 @@
+#pragma once
+#include <algorithm>
+#include <cstdint>
+#include <limits>
+
+#if !defined(FLOWSHOP_NO_SIMD) && defined(__AVX512F__) && defined(__AVX512DQ__)
+#define FLOWSHOP_SIMD_AVX512 1
+#include <immintrin.h>
+#elif !defined(FLOWSHOP_NO_SIMD) && defined(__AVX2__)
+#define FLOWSHOP_SIMD_AVX2 1
+#include <immintrin.h>
+#endif
+
+namespace flowshop {
+namespace kernels {
+
+// ---------- Closed-form kernels on structure-of-arrays data ----------
+// All kernels work on plain long long arrays (see JobsSoA) and give exactly
+// the scalar results: integer adds, maxes and products only. The SIMD path is
+// chosen at compile time (-mavx2, or -mavx512f -mavx512dq / -march=native);
+// define FLOWSHOP_NO_SIMD to force the scalar loops.
+//
+// The prefix max is seeded with 0, as in computeObjectiveClosedForm.
+
+inline const char* simdLevel() {
+#if defined(FLOWSHOP_SIMD_AVX512)
+    return "avx512";
+#elif defined(FLOWSHOP_SIMD_AVX2)
+    return "avx2";
+#else
+    return "scalar";
+#endif
+}
+
+#if defined(FLOWSHOP_SIMD_AVX512)
+
+using Vec = __m512i;
+constexpr int kLanes = 8;
+
+inline Vec loadv(const long long* p) { return _mm512_loadu_si512(p); }
+inline void storev(long long* p, Vec v) { _mm512_storeu_si512(p, v); }
+inline Vec splat(long long x) { return _mm512_set1_epi64(x); }
+inline Vec addv(Vec a, Vec b) { return _mm512_add_epi64(a, b); }
+inline Vec subv(Vec a, Vec b) { return _mm512_sub_epi64(a, b); }
+
+// GCC 12 writes the unmasked max / min / permute / alignr / extract (and the
+// reduce and cast helpers built on them) as masked builtins over an undefined
+// vector, which -Wmaybe-uninitialized reports at every inlined use. The
+// zero-masked forms below are the same instructions without that operand.
+constexpr __mmask8 kAllLanes = 0xFF;
+
+inline Vec maxv(Vec a, Vec b) { return _mm512_maskz_max_epi64(kAllLanes, a, b); }
+inline Vec minv(Vec a, Vec b) { return _mm512_maskz_min_epi64(kAllLanes, a, b); }
+inline Vec mulv(Vec a, Vec b) { return _mm512_mullo_epi64(a, b); }
+inline Vec lastLane(Vec v) { return _mm512_maskz_permutexvar_epi64(kAllLanes, _mm512_set1_epi64(7), v); }
+
+// Rotate by k lanes (lane j takes lane j + k mod 8).
+template <int k>
+inline Vec rotateDown(Vec x) { return _mm512_maskz_alignr_epi64(kAllLanes, x, x, k); }
+
+// Lane 0 (_mm512_castsi512_si128 is one of those extracts).
+inline long long firstLane(Vec v) { return _mm_cvtsi128_si64(_mm512_maskz_extracti64x2_epi64(0x3, v, 0)); }
+
+inline long long hsum(Vec v) {
+    v = addv(v, rotateDown<4>(v));
+    v = addv(v, rotateDown<2>(v));
+    v = addv(v, rotateDown<1>(v));
+    return firstLane(v);
+}
+
+inline long long hmin(Vec v) {
+    v = minv(v, rotateDown<4>(v));
+    v = minv(v, rotateDown<2>(v));
+    v = minv(v, rotateDown<1>(v));
+    return firstLane(v);
+}
+
+// Lanes moved up by k, low k lanes zeroed (alignr(x, zero, 8 - k)).
+template <int k>
+inline Vec shiftUp(Vec x) {
+    return _mm512_maskz_alignr_epi64(static_cast<__mmask8>(0xFF << k), x, x, 8 - k);
+}
+
+// Inclusive in-register scans: log2(8) shift-and-combine steps.
+inline Vec scanAdd(Vec x) {
+    x = addv(x, shiftUp<1>(x));
+    x = addv(x, shiftUp<2>(x));
+    x = addv(x, shiftUp<4>(x));
+    return x;
+}
+
+inline Vec scanMax(Vec x) {
+    x = maxv(x, shiftUp<1>(x));
+    x = maxv(x, shiftUp<2>(x));
+    x = maxv(x, shiftUp<4>(x));
+    return x;
+}
+
+#elif defined(FLOWSHOP_SIMD_AVX2)
+
+using Vec = __m256i;
+constexpr int kLanes = 4;
+
+inline Vec loadv(const long long* p) { return _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p)); }
+inline void storev(long long* p, Vec v) { _mm256_storeu_si256(reinterpret_cast<__m256i*>(p), v); }
+inline Vec splat(long long x) { return _mm256_set1_epi64x(x); }
+inline Vec addv(Vec a, Vec b) { return _mm256_add_epi64(a, b); }
+inline Vec subv(Vec a, Vec b) { return _mm256_sub_epi64(a, b); }
+inline Vec maxv(Vec a, Vec b) { return _mm256_blendv_epi8(b, a, _mm256_cmpgt_epi64(a, b)); }
+inline Vec minv(Vec a, Vec b) { return _mm256_blendv_epi8(a, b, _mm256_cmpgt_epi64(a, b)); }
+inline Vec lastLane(Vec v) { return _mm256_permute4x64_epi64(v, 0xFF); }
+
+// 64-bit low product from 32-bit multiplies (AVX2 has no vpmullq).
+inline Vec mulv(Vec a, Vec b) {
+    const Vec aHi = _mm256_srli_epi64(a, 32);
+    const Vec bHi = _mm256_srli_epi64(b, 32);
+    const Vec lo = _mm256_mul_epu32(a, b);
+    const Vec cross = _mm256_add_epi64(_mm256_mul_epu32(a, bHi), _mm256_mul_epu32(aHi, b));
+    return _mm256_add_epi64(lo, _mm256_slli_epi64(cross, 32));
+}
+
+inline long long hsum(Vec v) {
+    alignas(32) long long lanes[4];
+    storev(lanes, v);
+    return lanes[0] + lanes[1] + lanes[2] + lanes[3];
+}
+
+inline long long hmin(Vec v) {
+    alignas(32) long long lanes[4];
+    storev(lanes, v);
+    return std::min(std::min(lanes[0], lanes[1]), std::min(lanes[2], lanes[3]));
+}
+
+// [0, x0, x1, x2] and [0, 0, x0, x1]
+inline Vec shift1(Vec x) {
+    return _mm256_blend_epi32(_mm256_permute4x64_epi64(x, 0x90), _mm256_setzero_si256(), 0x03);
+}
+inline Vec shift2(Vec x) {
+    return _mm256_blend_epi32(_mm256_permute4x64_epi64(x, 0x40), _mm256_setzero_si256(), 0x0F);
+}
+
+inline Vec scanAdd(Vec x) {
+    x = addv(x, shift1(x));
+    return addv(x, shift2(x));
+}
+
+inline Vec scanMax(Vec x) {
+    x = maxv(x, shift1(x));
+    return maxv(x, shift2(x));
+}
+
+#endif
+
+// prefSum[r] = x[0] + ... + x[r]
+inline void inclusiveScanSum(const long long* x, int n, long long* prefSum) {
+    int r = 0;
+    long long carry = 0;
+#if defined(FLOWSHOP_SIMD_AVX512) || defined(FLOWSHOP_SIMD_AVX2)
+    Vec carryV = splat(0);
+    for (; r + kLanes <= n; r += kLanes) {
+        const Vec s = addv(scanAdd(loadv(x + r)), carryV);
+        storev(prefSum + r, s);
+        carryV = lastLane(s);
+    }
+    if (r > 0) carry = prefSum[r - 1];
+#endif
+    for (; r < n; ++r) {
+        carry += x[r];
+        prefSum[r] = carry;
+    }
+}
+
+// prefSum[r] = p[0] + ... + p[r],  prefMax[r] = max{0, p[0..r]}
+inline void inclusiveScanSumMax(const long long* p, int n, long long* prefSum, long long* prefMax) {
+    int r = 0;
+    long long sum = 0;
+    long long mx = 0;
+#if defined(FLOWSHOP_SIMD_AVX512) || defined(FLOWSHOP_SIMD_AVX2)
+    Vec sumV = splat(0);
+    Vec maxV = splat(0);
+    for (; r + kLanes <= n; r += kLanes) {
+        const Vec x = loadv(p + r);
+        const Vec s = addv(scanAdd(x), sumV);
+        const Vec mv = maxv(scanMax(x), maxV);
+        storev(prefSum + r, s);
+        storev(prefMax + r, mv);
+        sumV = lastLane(s);
+        maxV = lastLane(mv);
+    }
+    if (r > 0) {
+        sum = prefSum[r - 1];
+        mx = prefMax[r - 1];
+    }
+#endif
+    for (; r < n; ++r) {
+        sum += p[r];
+        if (p[r] > mx) mx = p[r];
+        prefSum[r] = sum;
+        prefMax[r] = mx;
+    }
+}
+
+// out[r] = a[r] * b[r]
+inline void multiply(const long long* a, const long long* b, int n, long long* out) {
+    int r = 0;
+#if defined(FLOWSHOP_SIMD_AVX512) || defined(FLOWSHOP_SIMD_AVX2)
+    for (; r + kLanes <= n; r += kLanes) {
+        storev(out + r, mulv(loadv(a + r), loadv(b + r)));
+    }
+#endif
+    for (; r < n; ++r) out[r] = a[r] * b[r];
+}
+
+// sum_r w_r * (P_r + (m-1) * M_r) for one sequence.
+inline long long closedFormObjective(const long long* p, const long long* w, int n, int m) {
+    const long long mm1 = static_cast<long long>(m - 1);
+    int r = 0;
+    long long sum = 0;
+    long long mx = 0;
+    long long obj = 0;
+#if defined(FLOWSHOP_SIMD_AVX512) || defined(FLOWSHOP_SIMD_AVX2)
+    Vec sumV = splat(0);
+    Vec maxV = splat(0);
+    Vec objV = splat(0);
+    const Vec mm1V = splat(mm1);
+    for (; r + kLanes <= n; r += kLanes) {
+        const Vec x = loadv(p + r);
+        const Vec s = addv(scanAdd(x), sumV);
+        const Vec mv = maxv(scanMax(x), maxV);
+        const Vec C = addv(s, mulv(mm1V, mv));
+        objV = addv(objV, mulv(loadv(w + r), C));
+        sumV = lastLane(s);
+        maxV = lastLane(mv);
+    }
+    if (r > 0) {
+        alignas(64) long long lanes[kLanes];
+        storev(lanes, sumV);
+        sum = lanes[0];
+        storev(lanes, maxV);
+        mx = lanes[0];
+        obj = hsum(objV);
+    }
+#endif
+    for (; r < n; ++r) {
+        sum += p[r];
+        if (p[r] > mx) mx = p[r];
+        obj += w[r] * (sum + mm1 * mx);
+    }
+    return obj;
+}
+
+// Objective increase of inserting job (p, w) at every position pos in [0..L]
+// of a sequence, in one sweep. Inputs are the sequence's prefix arrays with
+// index 0 for the empty prefix (length L+1 each): sums of p, max of p, sums
+// of w and sums of w_r * M_r. t is the first position in [1..L+1] whose
+// prefix max reaches p (L+1 if none); p raises M_r exactly for r in (pos, t).
+//   out[pos] = w (P_pos + p + (m-1) max(M_pos, p)) + p (W_L - W_pos)
+//            + (m-1) (p (W_{t-1} - W_pos) - (WM_{t-1} - WM_pos))    for pos < t-1
+// Both ranges are straight-line loops (no per-position branch).
+inline void insertionDeltas(const long long* prefP, const long long* prefMax,
+                            const long long* prefW, const long long* prefWM,
+                            int L, long long p, long long w, int m, int t, long long* out) {
+    const long long mm1 = static_cast<long long>(m - 1);
+    const long long head = w * p;              // w * p, the job's own processing
+    const long long tailW = prefW[L];          // W_L
+    const long long raisedW = prefW[t - 1];    // W_{t-1}
+    const long long raisedWM = prefWM[t - 1];  // WM_{t-1}
+    const int split = std::max(t - 1, 0);      // positions [0, split) raise later maxima
+
+    int pos = 0;
+#if defined(FLOWSHOP_SIMD_AVX512) || defined(FLOWSHOP_SIMD_AVX2)
+    const Vec pV = splat(p), wV = splat(w), mm1V = splat(mm1), headV = splat(head);
+    const Vec tailWV = splat(tailW), raisedWV = splat(raisedW), raisedWMV = splat(raisedWM);
+    auto base = [&](int at) {
+        const Vec W = loadv(prefW + at);
+        const Vec own = mulv(wV, addv(loadv(prefP + at), mulv(mm1V, maxv(loadv(prefMax + at), pV))));
+        return addv(addv(headV, own), mulv(pV, subv(tailWV, W)));
+    };
+    for (; pos + kLanes <= split; pos += kLanes) {
+        const Vec W = loadv(prefW + pos);
+        const Vec raise = subv(mulv(pV, subv(raisedWV, W)), subv(raisedWMV, loadv(prefWM + pos)));
+        storev(out + pos, addv(base(pos), mulv(mm1V, raise)));
+    }
+#endif
+    for (; pos < split; ++pos) {
+        out[pos] = head + w * (prefP[pos] + mm1 * std::max(prefMax[pos], p)) + p * (tailW - prefW[pos]) +
+                   mm1 * (p * (raisedW - prefW[pos]) - (raisedWM - prefWM[pos]));
+    }
+#if defined(FLOWSHOP_SIMD_AVX512) || defined(FLOWSHOP_SIMD_AVX2)
+    for (; pos + kLanes <= L + 1; pos += kLanes) storev(out + pos, base(pos));
+#endif
+    for (; pos <= L; ++pos) {
+        out[pos] = head + w * (prefP[pos] + mm1 * std::max(prefMax[pos], p)) + p * (tailW - prefW[pos]);
+    }
+}
+
+// Index of the smallest of x[0..n), n >= 1; ties go to the LAST one. A
+// vector min over the whole range, then a backward scan to its last copy.
+inline int argminLast(const long long* x, int n) {
+    int r = 0;
+    long long best = x[0];
+#if defined(FLOWSHOP_SIMD_AVX512) || defined(FLOWSHOP_SIMD_AVX2)
+    if (n >= kLanes) {
+        Vec minV = loadv(x);
+        for (r = kLanes; r + kLanes <= n; r += kLanes) minV = minv(minV, loadv(x + r));
+        best = hmin(minV);
+    }
+#endif
+    for (; r < n; ++r) best = std::min(best, x[r]);
+    int at = n - 1;
+    while (x[at] != best) --at;
+    return at;
+}
+
+// Position with the smallest insertionDeltas score (the last one on ties) and
+// that score. SIMD builds score every position into `scratch` (L+1 entries)
+// and take argminLast; the scalar build keeps a running minimum instead of
+// storing the scores.
+inline int bestInsertion(const long long* prefP, const long long* prefMax,
+                         const long long* prefW, const long long* prefWM,
+                         int L, long long p, long long w, int m, int t,
+                         long long* scratch, long long& bestDelta) {
+#if defined(FLOWSHOP_SIMD_AVX512) || defined(FLOWSHOP_SIMD_AVX2)
+    insertionDeltas(prefP, prefMax, prefW, prefWM, L, p, w, m, t, scratch);
+    const int bestPos = argminLast(scratch, L + 1);
+    bestDelta = scratch[bestPos];
+    return bestPos;
+#else
+    (void)scratch;
+    const long long mm1 = static_cast<long long>(m - 1);
+    const long long head = w * p;
+    const long long tailW = prefW[L];
+    const long long raisedW = prefW[t - 1];
+    const long long raisedWM = prefWM[t - 1];
+    const int split = std::max(t - 1, 0);
+
+    int bestPos = 0;
+    bestDelta = std::numeric_limits<long long>::max();
+    auto offer = [&](int pos, long long delta) {
+        if (delta <= bestDelta) {
+            bestDelta = delta;
+            bestPos = pos;
+        }
+    };
+    int pos = 0;
+    for (; pos < split; ++pos) {
+        offer(pos, head + w * (prefP[pos] + mm1 * std::max(prefMax[pos], p)) + p * (tailW - prefW[pos]) +
+                       mm1 * (p * (raisedW - prefW[pos]) - (raisedWM - prefWM[pos])));
+    }
+    for (; pos <= L; ++pos) {
+        offer(pos, head + w * (prefP[pos] + mm1 * std::max(prefMax[pos], p)) + p * (tailW - prefW[pos]));
+    }
+    return bestPos;
+#endif
+}
+
+// Objectives of `count` sequences of equal length n in one pass.
+// Layout is position-major: job r of sequence k is at p[r * count + k].
+// Lanes run independent sequences, so there is no scan inside a register.
+inline void closedFormObjectivesBatch(const long long* p, const long long* w,
+                                      int n, int count, int m, long long* out) {
+    const long long mm1 = static_cast<long long>(m - 1);
+    int k = 0;
+#if defined(FLOWSHOP_SIMD_AVX512) || defined(FLOWSHOP_SIMD_AVX2)
+    const Vec mm1V = splat(mm1);
+    for (; k + kLanes <= count; k += kLanes) {
+        Vec sumV = splat(0);
+        Vec maxV = splat(0);
+        Vec objV = splat(0);
+        for (int r = 0; r < n; ++r) {
+            const size_t at = static_cast<size_t>(r) * count + k;
+            const Vec x = loadv(p + at);
+            sumV = addv(sumV, x);
+            maxV = maxv(maxV, x);
+            objV = addv(objV, mulv(loadv(w + at), addv(sumV, mulv(mm1V, maxV))));
+        }
+        storev(out + k, objV);
+    }
+#endif
+    for (; k < count; ++k) {
+        long long sum = 0, mx = 0, obj = 0;
+        for (int r = 0; r < n; ++r) {
+            const size_t at = static_cast<size_t>(r) * count + k;
+            sum += p[at];
+            if (p[at] > mx) mx = p[at];
+            obj += w[at] * (sum + mm1 * mx);
+        }
+        out[k] = obj;
+    }
+}
+
+} // namespace kernels
+} // namespace flowshop
@@ -0,0 +1,357 @@
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <random>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+#include "FlowShopOutsource.cpp"
+
+// ---------- Kernel microbenchmarks ----------
+// Times single building blocks in isolation, over a range of sizes:
+//   closed_form        computeObjectiveClosedForm on a std::vector<Job> sequence
+//   closed_form_soa    the same on JobsSoA (the kernels:: path the black box uses)
+//   closed_form_batch  kernels::closedFormObjectivesBatch on 16 shuffles of the
+//                      jobs at once (checked against closed_form first)
+//   objective_dp       computeObjectiveDP with a reused machine row
+//   sort_wspt          the WSPT sort at the start of solveWSPT_MCI
+//   black_box          WSPT-MCI objective on presorted jobs with a SolverContext
+//   dp_row             one DP row (U = n columns) via computeDPColumns, the
+//                      bit-walk path with no cache, so every keep branch runs
+//                      the black box
+//   dp_rows            all n DP rows via runDPRows, the solveDP path (interned
+//                      sets and the in-house lower bound)
+// For each: ns/op, allocations/op (only with -DFLOWSHOP_STATS, "-" otherwise)
+// and throughput in jobs/s (n jobs per op, 16 n for closed_form_batch).
+// --write-baseline stores ns/op; --baseline compares against it and exits with
+// 2 when any kernel is slower than threshold x its baseline.
+
+namespace {
+
+struct BenchOptions {
+    std::vector<int> sizes{16, 64, 256, 1024};
+    int dpRowMaxN = 128;            // dp_row / dp_rows cost up to U * n black-box jobs per row, so cap them
+    double minTimeMs = 50.0;        // per kernel and size, split over the samples
+    int samples = 5;                // timed batches; ns/op is their median
+    int m = 5;
+    unsigned int seed = 1;
+    std::string filter;             // substring of the kernel name
+    std::string baselinePath;
+    std::string writeBaselinePath;
+    double threshold = 1.25;        // allowed ns/op ratio against the baseline
+};
+
+struct BenchResult {
+    std::string name;
+    int n = 0;
+    long long iterations = 0;
+    double nsPerOp = 0.0;
+    double allocsPerOp = -1.0;      // < 0: not measured (stats build off)
+    double jobsPerSecond = 0.0;
+};
+
+// Keeps results observable so the timed calls are not optimized away.
+volatile long long benchSink = 0;
+
+// Doubles the batch size until one batch takes minTimeMs / samples, then
+// times `samples` batches of that size and keeps the median (the machine's
+// noise mostly shows up as slow outliers).
+template <class Op>
+BenchResult runKernel(const std::string& name, int n, const BenchOptions& opts, Op&& op,
+                      long long jobsPerOp = -1) {
+    using Clock = std::chrono::steady_clock;
+    auto timeBatch = [&](long long iterations) {
+        const auto start = Clock::now();
+        for (long long k = 0; k < iterations; ++k) op();
+        return static_cast<double>(
+            std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - start).count());
+    };
+
+    op();   // warmup (first-touch allocations, caches)
+    const double batchNs = opts.minTimeMs * 1e6 / opts.samples;
+    long long iterations = 1;
+    while (timeBatch(iterations) < batchNs && iterations < (1LL << 40)) iterations *= 2;
+
+    std::vector<double> perOp;
+    const flowshop::SolveStats before = flowshop::statsSnapshot();
+    for (int k = 0; k < opts.samples; ++k) {
+        perOp.push_back(timeBatch(iterations) / static_cast<double>(iterations));
+    }
+    const flowshop::SolveStats used = flowshop::statsSince(before);
+    std::sort(perOp.begin(), perOp.end());
+
+    BenchResult r;
+    r.name = name;
+    r.n = n;
+    r.iterations = iterations * opts.samples;
+    r.nsPerOp = perOp[perOp.size() / 2];
+    if (flowshop::statsEnabled) {
+        r.allocsPerOp = static_cast<double>(used.allocations) / static_cast<double>(r.iterations);
+    }
+    if (jobsPerOp < 0) jobsPerOp = n;
+    r.jobsPerSecond = r.nsPerOp > 0.0 ? jobsPerOp * 1e9 / r.nsPerOp : 0.0;
+    return r;
+}
+
+std::vector<flowshop::Job> randomJobs(int n, unsigned int seed) {
+    std::mt19937 rng(seed);
+    std::uniform_int_distribution<int> dist(1, 100);
+    std::vector<flowshop::Job> jobs;
+    jobs.reserve(n);
+    for (int i = 0; i < n; ++i) jobs.push_back(flowshop::Job{i, dist(rng), dist(rng)});
+    return jobs;
+}
+
+bool selected(const BenchOptions& opts, const std::string& name) {
+    return opts.filter.empty() || name.find(opts.filter) != std::string::npos;
+}
+
+std::vector<BenchResult> runAll(const BenchOptions& opts) {
+    std::vector<BenchResult> results;
+    const int m = opts.m;
+
+    for (int n : opts.sizes) {
+        const std::vector<flowshop::Job> jobs = randomJobs(n, opts.seed + static_cast<unsigned int>(n));
+
+        if (selected(opts, "closed_form")) {
+            results.push_back(runKernel("closed_form", n, opts, [&]() {
+                benchSink = benchSink + flowshop::computeObjectiveClosedForm(jobs, m);
+            }));
+        }
+        if (selected(opts, "closed_form_soa")) {
+            const flowshop::JobsSoA soa(jobs);
+            results.push_back(runKernel("closed_form_soa", n, opts, [&]() {
+                benchSink = benchSink + flowshop::computeObjectiveClosedForm(soa, m);
+            }));
+        }
+        if (selected(opts, "closed_form_batch")) {
+            // Position-major: job r of sequence k at [r * count + k].
+            const int count = 16;
+            std::vector<long long> p(static_cast<size_t>(n) * count), w(p.size()), out(count);
+            std::vector<flowshop::Job> shuffled = jobs;
+            std::mt19937 rng(opts.seed);
+            std::vector<long long> expected(count);
+            for (int k = 0; k < count; ++k) {
+                std::shuffle(shuffled.begin(), shuffled.end(), rng);
+                for (int r = 0; r < n; ++r) {
+                    p[static_cast<size_t>(r) * count + k] = shuffled[r].p;
+                    w[static_cast<size_t>(r) * count + k] = shuffled[r].w;
+                }
+                expected[k] = flowshop::computeObjectiveClosedForm(shuffled, m);
+            }
+            flowshop::kernels::closedFormObjectivesBatch(p.data(), w.data(), n, count, m, out.data());
+            if (out != expected) throw std::runtime_error("closedFormObjectivesBatch differs from closed_form");
+            results.push_back(runKernel("closed_form_batch", n, opts, [&]() {
+                flowshop::kernels::closedFormObjectivesBatch(p.data(), w.data(), n, count, m, out.data());
+                benchSink = benchSink + out[0];
+            }, static_cast<long long>(n) * count));
+        }
+        if (selected(opts, "objective_dp")) {
+            std::vector<long long> row;
+            results.push_back(runKernel("objective_dp", n, opts, [&]() {
+                benchSink = benchSink + flowshop::computeObjectiveDP(jobs, m, row);
+            }));
+        }
+        if (selected(opts, "sort_wspt")) {
+            std::vector<flowshop::Job> buffer;
+            buffer.reserve(jobs.size());
+            results.push_back(runKernel("sort_wspt", n, opts, [&]() {
+                buffer.assign(jobs.begin(), jobs.end());
+                flowshop::sortWSPT(buffer);
+                benchSink = benchSink + buffer.front().id;
+            }));
+        }
+        if (selected(opts, "black_box")) {
+            std::vector<flowshop::Job> sorted = jobs;
+            flowshop::sortWSPT(sorted);
+            flowshop::SolverContext ctx;
+            results.push_back(runKernel("black_box", n, opts, [&]() {
+                ctx.reset();
+                benchSink = benchSink + ctx.objectivePresorted(sorted, m);
+            }));
+        }
+        std::vector<int> costs(n);
+        {
+            std::mt19937 rng(opts.seed);
+            for (int& u : costs) u = 1 + static_cast<int>(rng() % 4);
+        }
+        if (selected(opts, "dp_row") && n <= opts.dpRowMaxN) {
+            // Rows 1..n-1 once, then time row n against them.
+            const int U = n;
+            const flowshop::WSPTOrder order(jobs);
+            flowshop_ext::SolverWorkspace ws;
+            ws.beginInstance();
+            ws.prevRow.assign(static_cast<size_t>(U) + 1, 0LL);
+            ws.curRow.resize(static_cast<size_t>(U) + 1);
+            ws.decisions.reset(n, U);
+            for (int i = 1; i < n; ++i) {
+                flowshop_ext::computeDPColumns(i, 0, U + 1, ws.prevRow, ws.curRow, ws.decisions, costs,
+                                               order, m, ws.keepList, ws.keepIndices, nullptr, ws.context);
+                ws.prevRow.swap(ws.curRow);
+            }
+            results.push_back(runKernel("dp_row", n, opts, [&]() {
+                ws.context.reset();
+                flowshop_ext::computeDPColumns(n, 0, U + 1, ws.prevRow, ws.curRow, ws.decisions, costs,
+                                               order, m, ws.keepList, ws.keepIndices, nullptr, ws.context);
+                benchSink = benchSink + ws.curRow[U];
+            }));
+        }
+        if (selected(opts, "dp_rows") && n <= opts.dpRowMaxN) {
+            // What solveDP runs: every row, with interned sets and the lower
+            // bound (runDPRows resets ws.sets). A single row cannot be timed
+            // this way, since the first run leaves its objectives in the table.
+            const int U = n;
+            flowshop_ext::SolverWorkspace ws;
+            ws.beginInstance();
+            results.push_back(runKernel("dp_rows", n, opts, [&]() {
+                ws.context.reset();
+                flowshop_ext::runDPRows(jobs, costs, m, U, ws, nullptr);
+                benchSink = benchSink + ws.prevRow[U];
+            }));
+        }
+    }
+    return results;
+}
+
+// ---------- Baseline file ----------
+// One line per kernel and size: "<name> <n> <ns/op>"; '#' starts a comment.
+using Baseline = std::map<std::pair<std::string, int>, double>;
+
+Baseline readBaseline(const std::string& path) {
+    std::ifstream in(path);
+    if (!in) throw std::runtime_error("cannot open baseline " + path);
+    Baseline baseline;
+    std::string line;
+    while (std::getline(in, line)) {
+        if (line.empty() || line[0] == '#') continue;
+        std::istringstream fields(line);
+        std::string name;
+        int n = 0;
+        double ns = 0.0;
+        if (!(fields >> name >> n >> ns)) throw std::runtime_error("bad baseline line: " + line);
+        baseline[{name, n}] = ns;
+    }
+    return baseline;
+}
+
+void writeBaseline(const std::string& path, const std::vector<BenchResult>& results) {
+    std::ofstream out(path);
+    if (!out) throw std::runtime_error("cannot write baseline " + path);
+    out << "# flowshop microbench baseline: <kernel> <n> <ns/op> (" << flowshop::kernels::simdLevel() << ")\n";
+    out << std::fixed << std::setprecision(1);
+    for (const auto& r : results) out << r.name << " " << r.n << " " << r.nsPerOp << "\n";
+}
+
+// Prints the table; returns the number of kernels over the threshold.
+int report(const std::vector<BenchResult>& results, const Baseline* baseline, double threshold) {
+    std::cout << std::left << std::setw(19) << "kernel" << std::right << std::setw(7) << "n"
+              << std::setw(14) << "ns/op" << std::setw(12) << "allocs/op" << std::setw(14) << "jobs/s";
+    if (baseline) std::cout << std::setw(10) << "vs base";
+    std::cout << "\n";
+
+    int regressions = 0;
+    for (const auto& r : results) {
+        std::cout << std::left << std::setw(19) << r.name << std::right << std::setw(7) << r.n
+                  << std::fixed << std::setprecision(1) << std::setw(14) << r.nsPerOp;
+        if (r.allocsPerOp < 0.0) {
+            std::cout << std::setw(12) << "-";
+        } else {
+            std::cout << std::setprecision(2) << std::setw(12) << r.allocsPerOp;
+        }
+        std::cout << std::scientific << std::setprecision(3) << std::setw(14) << r.jobsPerSecond;
+        if (baseline) {
+            const auto it = baseline->find({r.name, r.n});
+            if (it == baseline->end() || it->second <= 0.0) {
+                std::cout << std::setw(10) << "new";
+            } else {
+                const double ratio = r.nsPerOp / it->second;
+                std::cout << std::fixed << std::setprecision(2) << std::setw(9) << ratio << "x";
+                if (ratio > threshold) {
+                    std::cout << "  SLOWER";
+                    ++regressions;
+                }
+            }
+        }
+        std::cout << std::defaultfloat << "\n";
+    }
+    return regressions;
+}
+
+std::vector<int> parseSizes(const std::string& text) {
+    std::vector<int> sizes;
+    std::stringstream in(text);
+    std::string item;
+    while (std::getline(in, item, ',')) {
+        if (!item.empty()) sizes.push_back(std::stoi(item));
+    }
+    if (sizes.empty() || *std::min_element(sizes.begin(), sizes.end()) <= 0) {
+        throw std::invalid_argument("--sizes expects positive comma-separated sizes");
+    }
+    return sizes;
+}
+
+BenchOptions parseOptions(int argc, char** argv) {
+    BenchOptions opts;
+    for (int i = 1; i < argc; ++i) {
+        const std::string arg = argv[i];
+        if (arg == "--sizes" && i + 1 < argc) {
+            opts.sizes = parseSizes(argv[++i]);
+        } else if (arg == "--dp-row-max-n" && i + 1 < argc) {
+            opts.dpRowMaxN = std::stoi(argv[++i]);
+        } else if (arg == "--min-time-ms" && i + 1 < argc) {
+            opts.minTimeMs = std::max(1.0, std::stod(argv[++i]));
+        } else if (arg == "--samples" && i + 1 < argc) {
+            opts.samples = std::max(1, std::stoi(argv[++i]));
+        } else if (arg == "--m" && i + 1 < argc) {
+            opts.m = std::max(1, std::stoi(argv[++i]));
+        } else if (arg == "--seed" && i + 1 < argc) {
+            opts.seed = static_cast<unsigned int>(std::stoul(argv[++i]));
+        } else if (arg == "--filter" && i + 1 < argc) {
+            opts.filter = argv[++i];
+        } else if (arg == "--baseline" && i + 1 < argc) {
+            opts.baselinePath = argv[++i];
+        } else if (arg == "--write-baseline" && i + 1 < argc) {
+            opts.writeBaselinePath = argv[++i];
+        } else if (arg == "--threshold" && i + 1 < argc) {
+            opts.threshold = std::stod(argv[++i]);
+            if (!(opts.threshold > 0.0)) throw std::invalid_argument("--threshold must be positive");
+        } else {
+            throw std::invalid_argument("unknown option: " + arg);
+        }
+    }
+    return opts;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    try {
+        const BenchOptions opts = parseOptions(argc, argv);
+        std::cout << "SIMD: " << flowshop::kernels::simdLevel() << ", m = " << opts.m
+                  << (flowshop::statsEnabled ? "" : " (build with -DFLOWSHOP_STATS for allocs/op)") << "\n";
+
+        const std::vector<BenchResult> results = runAll(opts);
+
+        Baseline baseline;
+        if (!opts.baselinePath.empty()) baseline = readBaseline(opts.baselinePath);
+        const int regressions = report(results, opts.baselinePath.empty() ? nullptr : &baseline, opts.threshold);
+
+        if (!opts.writeBaselinePath.empty()) {
+            writeBaseline(opts.writeBaselinePath, results);
+            std::cout << "Baseline written to " << opts.writeBaselinePath << "\n";
+        }
+        if (regressions > 0) {
+            std::cout << regressions << " kernel(s) slower than " << opts.threshold << "x the baseline\n";
+            return 2;
+        }
+        return 0;
+    } catch (const std::exception& ex) {
+        std::cerr << "\nFatal error: " << ex.what() << std::endl;
+        return 1;
+    }
+}
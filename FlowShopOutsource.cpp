@@ -1,9 +1,16 @@
+#pragma once
 #include <vector>
 #include <cmath>
+#include <cstdint>
 #include <algorithm>
+#include <atomic>
+#include <chrono>
 #include <iostream>
 #include <limits>
+#include <map>
 #include <numeric>
+#include <tuple>
+#include <unordered_map>
 #include <unordered_set>
 #include <stdexcept>
 #include "FlowShopWSPTMCI.cpp"
@@ -17,26 +24,536 @@ struct NaiveResult {
     long long outsourcingCost = 0;
 };
 
-struct DPState {
-    long long objective = std::numeric_limits<long long>::max();
-    std::vector<flowshop::Job> inhouseJobs;
+// Counters for one solve (all zero unless built with -DFLOWSHOP_STATS); see
+// flowshop::statsSnapshot / statsSince in FlowShopStats.cpp.
+using flowshop::SolveStats;
+
+// One bit per DP cell (i, c): set when job i-1 is outsourced in dp[i][c].
+// The in-house set of any cell is rebuilt by walking the bits back to row 0.
+class DPDecisionTable {
+public:
+    DPDecisionTable() = default;
+    DPDecisionTable(int rows, int U) { reset(rows, U); }
+
+    // Clear to `rows` x (U+1) cells, reusing the existing storage when it fits.
+    void reset(int rows, int U) {
+        wordsPerRow_ = (static_cast<size_t>(U) + 1 + 63) / 64;
+        bits_.assign(static_cast<size_t>(rows) * wordsPerRow_, 0);
+    }
+
+    // Grow or shrink to `rows` rows: rows 1..kept keep their bits, later rows are cleared.
+    void keepRows(int kept, int rows) {
+        bits_.resize(static_cast<size_t>(rows) * wordsPerRow_);
+        const size_t from = static_cast<size_t>(std::min(kept, rows)) * wordsPerRow_;
+        std::fill(bits_.begin() + from, bits_.end(), 0);
+    }
+
+    void setOutsourced(int i, int c) {
+        bits_[index(i, c)] |= 1ULL << (c & 63);
+    }
+
+    bool outsourced(int i, int c) const {
+        return (bits_[index(i, c)] >> (c & 63)) & 1ULL;
+    }
+
+    // In-house jobs of dp[i][c], in job index order (the order the black box
+    // has always been given). Reuses `out`'s capacity.
+    void collectInhouse(int i, int c,
+                        const std::vector<flowshop::Job>& allJobs,
+                        const std::vector<int>& outsourcingCosts,
+                        std::vector<flowshop::Job>& out) const {
+        out.clear();
+        for (int row = i; row >= 1; --row) {
+            if (outsourced(row, c)) {
+                c -= outsourcingCosts[row - 1];
+            } else {
+                out.push_back(allJobs[row - 1]);
+            }
+        }
+        std::reverse(out.begin(), out.end());
+    }
+
+    // Same walk as collectInhouse, but yields job indices (in reverse index order).
+    void collectInhouseIndices(int i, int c,
+                               const std::vector<int>& outsourcingCosts,
+                               std::vector<int>& out) const {
+        out.clear();
+        for (int row = i; row >= 1; --row) {
+            if (outsourced(row, c)) {
+                c -= outsourcingCosts[row - 1];
+            } else {
+                out.push_back(row - 1);
+            }
+        }
+    }
+
+private:
+    size_t index(int i, int c) const {
+        return static_cast<size_t>(i - 1) * wordsPerRow_ + (static_cast<size_t>(c) >> 6);
+    }
+
+    size_t wordsPerRow_ = 0;
+    std::vector<std::uint64_t> bits_;
+};
+
+// Lower bound on what the black box can return for an in-house set S: every
+// sequence has C_j >= P_j + (m-1) p_j, so sum w_j C_j is at least
+// m * sum w p plus the Smith pair terms min(w_a p_b, w_b p_a) over the pairs
+// of S (their sum is the single-machine WSPT objective minus sum w p). Adding
+// job j to S raises it by m w_j p_j + w_j * (p of S ranked before j) +
+// p_j * (w of S ranked after j), ranks being `order`'s WSPT ranks. Solvers
+// skip the black-box call of a set whose bound is already above their best.
+// Valid when every p > 0 (so the ranks exist) and every w >= 0.
+static bool inhouseBoundApplies(const flowshop::WSPTOrder& order) {
+    if (!order.presorted()) return false;
+    return std::all_of(order.jobs().begin(), order.jobs().end(),
+                       [](const flowshop::Job& j) { return j.w >= 0; });
+}
+
+// The rise for job j given the set's p before j and w after j.
+static long long inhouseBoundRise(const flowshop::Job& job, int m,
+                                  long long pBefore, long long wAfter) {
+    return static_cast<long long>(m) * job.w * job.p + job.w * pBefore + job.p * wAfter;
+}
+
+// Running bound of a set that gains and loses one job at a time (the naive
+// walks): Fenwick sums of p and w over WSPT rank, O(log n) per change.
+class InhouseBoundTracker {
+public:
+    InhouseBoundTracker(const flowshop::WSPTOrder& order, int m)
+        : order_(order), m_(m), p_(order.size() + 1, 0), w_(order.size() + 1, 0) {}
+
+    void add(int j) {
+        value_ += rise(j);
+        update(j, 1);
+    }
+
+    void remove(int j) {
+        update(j, -1);
+        value_ -= rise(j);
+    }
+
+    long long value() const { return value_; }
+
+private:
+    long long rise(int j) const {
+        const int r = order_.rankOf(j);
+        return inhouseBoundRise(order_.jobs()[j], m_, prefix(p_, r), totalW_ - prefix(w_, r + 1));
+    }
+
+    void update(int j, int sign) {
+        const auto& job = order_.jobs()[j];
+        for (size_t k = static_cast<size_t>(order_.rankOf(j)) + 1; k < p_.size(); k += k & (~k + 1)) {
+            p_[k] += sign * job.p;
+            w_[k] += sign * job.w;
+        }
+        totalW_ += sign * job.w;
+    }
+
+    // Sum over ranks [0, r).
+    static long long prefix(const std::vector<long long>& tree, int r) {
+        long long sum = 0;
+        for (size_t k = static_cast<size_t>(r); k > 0; k &= k - 1) sum += tree[k];
+        return sum;
+    }
+
+    const flowshop::WSPTOrder& order_;
+    int m_;
+    std::vector<long long> p_;
+    std::vector<long long> w_;
+    long long totalW_ = 0;
+    long long value_ = 0;
+};
+
+// Hash-consed in-house sets of the DP. A set is one node (parent set, last
+// job index); the DP only ever appends job i-1 to a set of jobs below i-1, so
+// every set has exactly one node: equal ids mean equal sets, and equal sets
+// in any number of cells take one node. A node also remembers the set's
+// black-box objective once it is known, so a repeated keep branch costs one
+// hash lookup instead of a back-pointer walk plus a cache key.
+class InhouseSetTable {
+public:
+    static constexpr int Empty = 0;
+
+    InhouseSetTable() { reset(); }
+
+    // Back to the empty set only (keeps capacity).
+    void reset() {
+        nodes_.assign(1, Node{-1, -1, 0, 0, true});
+        index_.clear();
+    }
+
+    // Id of `set` plus job index `job` (job above every index already in `set`).
+    int extend(int set, int job) {
+        const std::uint64_t key = (static_cast<std::uint64_t>(static_cast<std::uint32_t>(set)) << 32) |
+                                  static_cast<std::uint32_t>(job);
+        auto [it, inserted] = index_.try_emplace(key, static_cast<int>(nodes_.size()));
+        if (inserted) nodes_.push_back(Node{set, job, 0, 0, false});
+        return it->second;
+    }
+
+    long long lowerBound(int set) const { return nodes_[set].lowerBound; }
+    void setLowerBound(int set, long long bound) { nodes_[set].lowerBound = bound; }
+
+    // Calls f(job index) for every job of `set`, highest index first.
+    template <class F>
+    void forEachJob(int set, F f) const {
+        for (; set != Empty; set = nodes_[set].parent) f(nodes_[set].job);
+    }
+
+    bool findObjective(int set, long long& objective) const {
+        const Node& node = nodes_[set];
+        if (!node.known) return false;
+        objective = node.objective;
+        return true;
+    }
+
+    void setObjective(int set, long long objective) {
+        nodes_[set].objective = objective;
+        nodes_[set].known = true;
+    }
+
+    // Job indices of `set`, in reverse index order (as collectInhouseIndices).
+    void collectIndices(int set, std::vector<int>& out) const {
+        out.clear();
+        forEachJob(set, [&](int job) { out.push_back(job); });
+    }
+
+    size_t size() const { return nodes_.size(); }
+
+private:
+    struct Node {
+        int parent;
+        int job;
+        long long objective;
+        long long lowerBound;   // see inhouseBoundApplies; 0 when not tracked
+        bool known;
+    };
+
+    std::vector<Node> nodes_;
+    std::unordered_map<std::uint64_t, int> index_;
+};
+
+// Set ids of the two rolling DP rows, next to the objective rows. With
+// `bounded`, every new set gets its lower bound (one walk over its parent).
+struct DPSharedSets {
+    InhouseSetTable table;
+    std::vector<int> prev;
+    std::vector<int> cur;
+    bool bounded = false;
+
+    void reset(int U, bool withBounds = false) {
+        table.reset();
+        prev.assign(static_cast<size_t>(U) + 1, InhouseSetTable::Empty);
+        cur.resize(static_cast<size_t>(U) + 1);
+        bounded = withBounds;
+    }
+
+    int extend(int set, int job, const flowshop::WSPTOrder& order, int m) {
+        const size_t before = table.size();
+        const int id = table.extend(set, job);
+        if (bounded && table.size() != before) {
+            const int r = order.rankOf(job);
+            long long pBefore = 0, wAfter = 0;
+            table.forEachJob(set, [&](int k) {
+                if (order.rankOf(k) < r) {
+                    pBefore += order.jobs()[k].p;
+                } else {
+                    wAfter += order.jobs()[k].w;
+                }
+            });
+            table.setLowerBound(id, table.lowerBound(set) +
+                                    inhouseBoundRise(order.jobs()[job], m, pBefore, wAfter));
+        }
+        return id;
+    }
+
+    void swapRows() { prev.swap(cur); }
+};
+
+// ---------- Black-box cache ----------
+// Canonical key of an in-house set: a bitmask of job ids when every id is
+// below 64, otherwise the sorted id list (compared exactly, never just hashed).
+// Keys name jobs by id, so an instance solved with a cache must not repeat
+// an id: checkUniqueIds below, called by checkDPInput and by the naive
+// search when it is handed a cache.
+struct SubsetKey {
+    std::uint64_t mask = 0;
+    std::vector<int> ids;   // empty for the bitmask form
+
+    bool operator==(const SubsetKey& other) const {
+        return mask == other.mask && ids == other.ids;
+    }
+};
+
+struct SubsetKeyHash {
+    size_t operator()(const SubsetKey& key) const {
+        std::uint64_t h = key.mask;
+        for (int id : key.ids) {
+            h = (h ^ static_cast<std::uint64_t>(id)) * 0x100000001b3ULL;
+        }
+        // splitmix64 finalizer
+        h += 0x9e3779b97f4a7c15ULL;
+        h = (h ^ (h >> 30)) * 0xbf58476d1ce4e5b9ULL;
+        h = (h ^ (h >> 27)) * 0x94d049bb133111ebULL;
+        return static_cast<size_t>(h ^ (h >> 31));
+    }
+};
+
+// Throws if two jobs share an id (they would collapse into one cache key).
+static void checkUniqueIds(const std::vector<flowshop::Job>& allJobs) {
+    std::uint64_t seen = 0;
+    bool narrow = true;
+    for (const auto& job : allJobs) {
+        if (job.id < 0 || job.id >= 64) {
+            narrow = false;
+            break;
+        }
+        if ((seen >> job.id) & 1ULL) throw std::invalid_argument("job ids must be unique");
+        seen |= 1ULL << job.id;
+    }
+    if (narrow) return;
+
+    std::vector<int> ids;
+    ids.reserve(allJobs.size());
+    for (const auto& job : allJobs) ids.push_back(job.id);
+    std::sort(ids.begin(), ids.end());
+    if (std::adjacent_find(ids.begin(), ids.end()) != ids.end()) {
+        throw std::invalid_argument("job ids must be unique");
+    }
+}
+
+// Key of the jobs allJobs[idx] for idx in `indices`.
+static SubsetKey makeSubsetKey(const std::vector<flowshop::Job>& allJobs,
+                               const std::vector<int>& indices) {
+    SubsetKey key;
+    bool narrow = true;
+    for (int idx : indices) {
+        const int id = allJobs[idx].id;
+        if (id < 0 || id >= 64) {
+            narrow = false;
+            break;
+        }
+        key.mask |= 1ULL << id;
+    }
+    if (!narrow) {
+        key.mask = 0;
+        key.ids.reserve(indices.size());
+        for (int idx : indices) key.ids.push_back(allJobs[idx].id);
+        std::sort(key.ids.begin(), key.ids.end());
+    }
+    return key;
+}
+
+static SubsetKey makeSubsetKey(const std::vector<flowshop::Job>& jobs) {
+    SubsetKey key;
+    bool narrow = true;
+    for (const auto& j : jobs) {
+        if (j.id < 0 || j.id >= 64) {
+            narrow = false;
+            break;
+        }
+        key.mask |= 1ULL << j.id;
+    }
+    if (!narrow) {
+        key.mask = 0;
+        key.ids.reserve(jobs.size());
+        for (const auto& j : jobs) key.ids.push_back(j.id);
+        std::sort(key.ids.begin(), key.ids.end());
+    }
+    return key;
+}
+
+// Bounded memo of black-box results for ONE instance (fixed jobs and m).
+// Solvers always hand the black box a set in job index order, so a set
+// always maps to the same Solution and caching it is exact.
+// Eviction is CLOCK (second chance) over a fixed number of slots.
+class BlackBoxCache {
+public:
+    explicit BlackBoxCache(int m, size_t capacity = 1 << 16, bool storeSequences = false)
+        : m_(m), capacity_(std::max<size_t>(capacity, 1)), storeSequences_(storeSequences) {
+        slots_.reserve(std::min<size_t>(capacity_, 1 << 12));
+        index_.reserve(std::min<size_t>(capacity_, 1 << 12));
+    }
+
+    int m() const { return m_; }
+    bool storesSequences() const { return storeSequences_; }
+
+    // Forget every entry and counter and rebind to a new instance (keeps capacity).
+    void reset(int m) {
+        m_ = m;
+        slots_.clear();
+        index_.clear();
+        hand_ = 0;
+        hits_ = 0;
+        misses_ = 0;
+    }
+    size_t size() const { return index_.size(); }
+    long long hits() const { return hits_; }
+    long long misses() const { return misses_; }
+
+    bool findObjective(const SubsetKey& key, long long& objective) {
+        const Slot* slot = touch(key);
+        if (!slot) return false;
+        objective = slot->objective;
+        return true;
+    }
+
+    // Only succeeds for entries that were stored with their sequence.
+    bool findSolution(const SubsetKey& key, flowshop::Solution& sol) {
+        const Slot* slot = touch(key, true);
+        if (!slot) return false;
+        sol.objective = slot->objective;
+        sol.sequence = slot->sequence;
+        return true;
+    }
+
+    void insert(SubsetKey key, const flowshop::Solution& sol) {
+        auto it = index_.find(key);
+        size_t pos;
+        if (it != index_.end()) {
+            pos = it->second;
+        } else {
+            pos = claimSlot();
+            slots_[pos].key = key;
+            index_.emplace(std::move(key), pos);
+        }
+
+        Slot& slot = slots_[pos];
+        slot.objective = sol.objective;
+        slot.hasSequence = storeSequences_;
+        if (storeSequences_) {
+            slot.sequence = sol.sequence;
+        } else {
+            slot.sequence.clear();
+        }
+        slot.referenced = true;
+    }
+
+    // Objective-only entry (no sequence, whatever storesSequences() says).
+    void insert(SubsetKey key, long long objective) {
+        auto it = index_.find(key);
+        size_t pos;
+        if (it != index_.end()) {
+            pos = it->second;
+        } else {
+            pos = claimSlot();
+            slots_[pos].key = key;
+            index_.emplace(std::move(key), pos);
+        }
+
+        Slot& slot = slots_[pos];
+        slot.objective = objective;
+        slot.hasSequence = false;
+        slot.sequence.clear();
+        slot.referenced = true;
+    }
+
+private:
+    struct Slot {
+        SubsetKey key;
+        long long objective = 0;
+        bool hasSequence = false;
+        bool referenced = false;
+        std::vector<flowshop::Job> sequence;
+    };
+
+    const Slot* touch(const SubsetKey& key, bool needSequence = false) {
+        auto it = index_.find(key);
+        if (it == index_.end() || (needSequence && !slots_[it->second].hasSequence)) {
+            ++misses_;
+            FLOWSHOP_COUNT(CacheMisses, 1);
+            return nullptr;
+        }
+        ++hits_;
+        FLOWSHOP_COUNT(CacheHits, 1);
+        Slot& slot = slots_[it->second];
+        slot.referenced = true;
+        return &slot;
+    }
+
+    size_t claimSlot() {
+        if (slots_.size() < capacity_) {
+            slots_.emplace_back();
+            return slots_.size() - 1;
+        }
+        // Second chance: skip (and clear) recently referenced slots.
+        while (slots_[hand_].referenced) {
+            slots_[hand_].referenced = false;
+            hand_ = (hand_ + 1) % capacity_;
+        }
+        const size_t victim = hand_;
+        hand_ = (hand_ + 1) % capacity_;
+        index_.erase(slots_[victim].key);
+        return victim;
+    }
+
+    int m_;
+    size_t capacity_;
+    bool storeSequences_;
+    std::vector<Slot> slots_;
+    std::unordered_map<SubsetKey, size_t, SubsetKeyHash> index_;
+    size_t hand_ = 0;
+    long long hits_ = 0;
+    long long misses_ = 0;
+};
+
+// Order in which solveNaiveDetailed walks the 2^n in-house masks.
+// Both modes return the same result: ties go to the numerically smallest mask.
+enum class NaiveEnumeration {
+    Ascending,  // mask = 0, 1, 2, ... ; rebuilds both job lists per mask (reference)
+    GrayCode,   // one job toggles per step; O(1) cost update, over-budget masks skipped early
+    SplitHalf   // meet in the middle: only budget-feasible (low, high) half pairs are visited
 };
 
+// Scratch that a thread can keep across many solves (see solveBatch): DP rows,
+// decision bits, the keep-list buffer, the interned in-house sets and the black
+// box's own buffers (flowshop::SolverContext). There is no black-box cache: the
+// DP's repeated sets are answered by `sets` and the naive walk never repeats a
+// set, so one would only ever miss. Every solve that takes a workspace rewinds
+// the context's arena first.
+struct SolverWorkspace {
+    std::vector<long long> prevRow;
+    std::vector<long long> curRow;
+    DPDecisionTable decisions;
+    std::vector<flowshop::Job> keepList;
+    std::vector<int> keepIndices;
+    DPSharedSets sets;
+    flowshop::SolverContext context;
+
+    void beginInstance() { context.reset(); }
+};
+
+// `cache` (optional) memoizes black-box calls across solves. Neither needs
+// one on its own: solveDP interns its in-house sets (InhouseSetTable), which
+// remember their objectives, and solveNaiveDetailed never repeats a set.
 NaiveResult solveNaiveDetailed(const std::vector<flowshop::Job>& allJobs,
                               const std::vector<int>& outsourcingCosts,
-                              int m, int U);
+                              int m, int U,
+                              BlackBoxCache* cache = nullptr,
+                              NaiveEnumeration enumeration = NaiveEnumeration::GrayCode);
+
+NaiveResult solveDP(const std::vector<flowshop::Job>& allJobs,
+                    const std::vector<int>& outsourcingCosts,
+                    int m, int U,
+                    BlackBoxCache* cache = nullptr);
 
 NaiveResult solveDP(const std::vector<flowshop::Job>& allJobs,
                     const std::vector<int>& outsourcingCosts,
-                    int m, int U);
+                    int m, int U,
+                    SolverWorkspace& ws);
+
+NaiveResult solveNaiveDetailed(const std::vector<flowshop::Job>& allJobs,
+                              const std::vector<int>& outsourcingCosts,
+                              int m, int U,
+                              SolverWorkspace& ws);
 
 
 long long getObjectiveOnly(const std::vector<flowshop::Job>& jobs, int m) {
     if (jobs.empty()) return 0;
     
 
-    std::ostream nullOut(nullptr);
-    flowshop::Solution sol = flowshop::solveWSPT_MCI(jobs, m, false, nullOut);
+    flowshop::Solution sol = flowshop::solveWSPT_MCI(jobs, m, false);
     
     return sol.objective;
 }
@@ -44,18 +561,126 @@ long long getObjectiveOnly(const std::vector<flowshop::Job>& jobs, int m) {
 static flowshop::Solution getSolutionOnly(const std::vector<flowshop::Job>& jobs, int m) {
     if (jobs.empty()) return flowshop::Solution{};
 
-    std::ostream nullOut(nullptr);
-    return flowshop::solveWSPT_MCI(jobs, m, false, nullOut);
+    return flowshop::solveWSPT_MCI(jobs, m, false);
+}
+
+static void checkCacheMatches(const BlackBoxCache& cache, int m) {
+    if (cache.m() != m) {
+        throw std::invalid_argument("BlackBoxCache was built for a different m");
+    }
+}
+
+long long getObjectiveOnly(const std::vector<flowshop::Job>& jobs, int m, BlackBoxCache* cache) {
+    if (!cache) return getObjectiveOnly(jobs, m);
+    if (jobs.empty()) return 0;
+    checkCacheMatches(*cache, m);
+
+    SubsetKey key = makeSubsetKey(jobs);
+    long long objective = 0;
+    if (cache->findObjective(key, objective)) return objective;
+
+    flowshop::Solution sol = getSolutionOnly(jobs, m);
+    cache->insert(std::move(key), sol);
+    return sol.objective;
+}
+
+static flowshop::Solution getSolutionOnly(const std::vector<flowshop::Job>& jobs, int m,
+                                          BlackBoxCache* cache) {
+    if (!cache) return getSolutionOnly(jobs, m);
+    if (jobs.empty()) return flowshop::Solution{};
+    checkCacheMatches(*cache, m);
+
+    SubsetKey key = makeSubsetKey(jobs);
+    flowshop::Solution sol;
+    if (cache->findSolution(key, sol)) return sol;
+
+    sol = getSolutionOnly(jobs, m);
+    cache->insert(std::move(key), sol);
+    return sol;
+}
+
+// Same as above for a subset read off `order` (already in WSPT order, no sort).
+long long getObjectiveOnly(const flowshop::WSPTOrder& order,
+                           const std::vector<flowshop::Job>& subsetInOrder,
+                           int m, BlackBoxCache* cache) {
+    if (subsetInOrder.empty()) return 0;
+
+    if (!cache) return order.solve(subsetInOrder, m, false).objective;
+    checkCacheMatches(*cache, m);
+
+    SubsetKey key = makeSubsetKey(subsetInOrder);
+    long long objective = 0;
+    if (cache->findObjective(key, objective)) return objective;
+
+    flowshop::Solution sol = order.solve(subsetInOrder, m, false);
+    cache->insert(std::move(key), sol);
+    return sol.objective;
+}
+
+// Black box on a miss: with `ctx`'s buffers, unless the cache wants sequences.
+static long long solveAndCache(const flowshop::WSPTOrder& order,
+                               const std::vector<flowshop::Job>& subsetInOrder,
+                               int m, BlackBoxCache* cache, SubsetKey&& key,
+                               flowshop::SolverContext& ctx) {
+    if (cache && cache->storesSequences()) {
+        flowshop::Solution sol = order.solve(subsetInOrder, m, false);
+        cache->insert(std::move(key), sol);
+        return sol.objective;
+    }
+    const long long objective = order.objective(subsetInOrder, m, ctx);
+    if (cache) cache->insert(std::move(key), objective);
+    return objective;
+}
+
+// Same, with the black box running on `ctx`'s reusable buffers.
+long long getObjectiveOnly(const flowshop::WSPTOrder& order,
+                           const std::vector<flowshop::Job>& subsetInOrder,
+                           int m, BlackBoxCache* cache,
+                           flowshop::SolverContext& ctx) {
+    if (subsetInOrder.empty()) return 0;
+
+    SubsetKey key;
+    if (cache) {
+        checkCacheMatches(*cache, m);
+        key = makeSubsetKey(subsetInOrder);
+        long long objective = 0;
+        if (cache->findObjective(key, objective)) return objective;
+    }
+    return solveAndCache(order, subsetInOrder, m, cache, std::move(key), ctx);
+}
+
+// Same for the jobs order.jobs()[idx], idx in `indices`: the cache is checked
+// first and only a miss builds the WSPT-ordered subset (in `scratch`).
+// `indices` is consumed (see WSPTOrder::indicesInOrder).
+static long long getObjectiveOnly(const flowshop::WSPTOrder& order,
+                                  std::vector<int>& indices,
+                                  int m, BlackBoxCache* cache,
+                                  std::vector<flowshop::Job>& scratch,
+                                  flowshop::SolverContext& ctx) {
+    if (indices.empty()) return 0;
+
+    SubsetKey key;
+    if (cache) {
+        checkCacheMatches(*cache, m);
+        key = makeSubsetKey(order.jobs(), indices);
+        long long objective = 0;
+        if (cache->findObjective(key, objective)) return objective;
+    }
+
+    order.indicesInOrder(indices, scratch);
+    return solveAndCache(order, scratch, m, cache, std::move(key), ctx);
 }
 
 // --- DP algorithm (Minimization knapsack variant) ---
 // dp[i][c] = best (minimum) objective using first i jobs with outsourcing budget <= c.
 // Each job is either kept in-house (added to the set evaluated by the black-box)
 // or outsourced (spending u_i budget and not appearing in the black-box set).
-NaiveResult solveDP(const std::vector<flowshop::Job>& allJobs,
-                    const std::vector<int>& outsourcingCosts,
-                    int m, int U) {
 
+static constexpr long long DP_INF = std::numeric_limits<long long>::max() / 4;
+
+static void checkDPInput(const std::vector<flowshop::Job>& allJobs,
+                         const std::vector<int>& outsourcingCosts,
+                         int U) {
     const int n = static_cast<int>(allJobs.size());
     if (n != static_cast<int>(outsourcingCosts.size())) {
         throw std::invalid_argument("outsourcingCosts size must match allJobs size");
@@ -64,74 +689,113 @@ NaiveResult solveDP(const std::vector<flowshop::Job>& allJobs,
         throw std::invalid_argument("U must be non-negative");
     }
 
-    const long long INF = std::numeric_limits<long long>::max() / 4;
-
     for (int i = 0; i < n; ++i) {
         if (outsourcingCosts[i] < 0) {
             throw std::invalid_argument("outsourcingCosts must be non-negative");
         }
     }
+    checkUniqueIds(allJobs);
+}
 
-    // Build DP table
-    std::vector<std::vector<DPState>> dp(n + 1, std::vector<DPState>(U + 1));
-
-    // Base: with 0 jobs, objective is 0 for any allowed budget.
-    for (int c = 0; c <= U; ++c) {
-        dp[0][c].objective = 0;
-        dp[0][c].inhouseJobs.clear();
-    }
+// Fill dp[i][cBegin..cEnd) from dp[i-1] (prevRow). Only reads row i-1 and the
+// decision bits of rows < i, so disjoint column ranges can run concurrently
+// as long as they do not share a 64-column word of row i.
+// The keep branch collects the in-house indices of dp[i-1][c] plus job i-1,
+// looks them up in the cache and, on a miss, reads the set off `order` so the
+// black box skips its sort. With `shared` (single-threaded callers only) the
+// set is interned first and only a set never seen before walks and looks up.
+static void computeDPColumns(int i, int cBegin, int cEnd,
+                             const std::vector<long long>& prevRow,
+                             std::vector<long long>& curRow,
+                             DPDecisionTable& decisions,
+                             const std::vector<int>& outsourcingCosts,
+                             const flowshop::WSPTOrder& order,
+                             int m,
+                             std::vector<flowshop::Job>& keepList,
+                             std::vector<int>& keepIndices,
+                             BlackBoxCache* cache,
+                             flowshop::SolverContext& ctx,
+                             DPSharedSets* shared = nullptr) {
+    const int u_i = outsourcingCosts[i - 1];
 
-    for (int i = 1; i <= n; ++i) {
-        const flowshop::Job& job = allJobs[i - 1];
-        const int u_i = outsourcingCosts[i - 1];
+    for (int c = cBegin; c < cEnd; ++c) {
+        long long best = DP_INF;
+        bool outsource = false;
+        int keepSet = InhouseSetTable::Empty;
+        const long long outObj = u_i <= c ? prevRow[c - u_i] : DP_INF;
 
-        for (int c = 0; c <= U; ++c) {
-            DPState best;
-            best.objective = INF;
-
-            // Option 1: Keep in-house
-            if (dp[i - 1][c].objective != INF) {
-                std::vector<flowshop::Job> keepList = dp[i - 1][c].inhouseJobs;
-                keepList.push_back(job);
-                const long long keepObj = getObjectiveOnly(keepList, m);
-
-                if (keepObj < best.objective) {
-                    best.objective = keepObj;
-                    best.inhouseJobs = std::move(keepList);
+        // Option 1: Keep in-house (row 0 is all zeros, so every cell is feasible)
+        {
+            long long keepObj = 0;
+            if (shared) {
+                keepSet = shared->extend(shared->prev[c], i - 1, order, m);
+                if (shared->table.findObjective(keepSet, keepObj)) {
+                    FLOWSHOP_COUNT(DPCellsPruned, 1);
+                } else if (shared->bounded && shared->table.lowerBound(keepSet) > outObj) {
+                    // Outsourcing wins outright (keeping only wins ties): no black box.
+                    FLOWSHOP_COUNT(DPCellsPruned, 1);
+                    FLOWSHOP_COUNT(BoundPruned, 1);
+                    keepObj = DP_INF;
+                } else {
+                    shared->table.collectIndices(keepSet, keepIndices);
+                    keepObj = getObjectiveOnly(order, keepIndices, m, cache, keepList, ctx);
+                    shared->table.setObjective(keepSet, keepObj);
                 }
+            } else {
+                decisions.collectInhouseIndices(i - 1, c, outsourcingCosts, keepIndices);
+                keepIndices.push_back(i - 1);
+                keepObj = getObjectiveOnly(order, keepIndices, m, cache, keepList, ctx);
             }
 
-            // Option 2: Outsource (if budget allows)
-            if (u_i <= c && dp[i - 1][c - u_i].objective != INF) {
-                const long long outObj = dp[i - 1][c - u_i].objective;
-                if (outObj < best.objective) {
-                    best.objective = outObj;
-                    best.inhouseJobs = dp[i - 1][c - u_i].inhouseJobs;
-                }
+            if (keepObj < best) {
+                best = keepObj;
             }
+        }
 
-            dp[i][c] = std::move(best);
+        // Option 2: Outsource (if budget allows)
+        if (outObj != DP_INF) {
+            if (outObj < best) {
+                best = outObj;
+                outsource = true;
+            }
         }
+
+        curRow[c] = best;
+        if (outsource) decisions.setOutsourced(i, c);
+        if (shared) shared->cur[c] = outsource ? shared->prev[c - u_i] : keepSet;
     }
+    FLOWSHOP_COUNT(DPCells, cEnd - cBegin);
+}
 
-    // dp[n][U] already represents best objective with outsourcing budget <= U
-    const DPState& bestState = dp[n][U];
+// Backtrack dp[n][U] into the final in-house order, outsourced list and cost.
+static NaiveResult dpResultFromDecisions(const std::vector<flowshop::Job>& allJobs,
+                                         const std::vector<int>& outsourcingCosts,
+                                         int m, int U,
+                                         const DPDecisionTable& decisions,
+                                         long long bestObjective,
+                                         BlackBoxCache* cache) {
+    const int n = static_cast<int>(allJobs.size());
 
     NaiveResult result;
-    result.objective = bestState.objective == INF ? 0 : bestState.objective;
+    result.objective = bestObjective == DP_INF ? 0 : bestObjective;
+
+    // Rebuild the in-house set by backtracking from dp[n][U]
+    std::vector<flowshop::Job> inhouseJobs;
+    inhouseJobs.reserve(n);
+    decisions.collectInhouse(n, U, allJobs, outsourcingCosts, inhouseJobs);
 
     // Final in-house sequence/order comes from the black-box solution
-    if (!bestState.inhouseJobs.empty()) {
-        flowshop::Solution sol = getSolutionOnly(bestState.inhouseJobs, m);
+    if (!inhouseJobs.empty()) {
+        flowshop::Solution sol = getSolutionOnly(inhouseJobs, m, cache);
         result.objective = sol.objective;
         result.inhouseOrder = std::move(sol.sequence);
     }
 
     // Build outsourced list + outsourcingCost
-    // (outsourced jobs are those NOT in bestState.inhouseJobs)
+    // (outsourced jobs are those NOT in inhouseJobs)
     std::unordered_set<int> inhouseIds;
-    inhouseIds.reserve(bestState.inhouseJobs.size());
-    for (const auto& j : bestState.inhouseJobs) {
+    inhouseIds.reserve(inhouseJobs.size());
+    for (const auto& j : inhouseJobs) {
         inhouseIds.insert(j.id);
     }
 
@@ -150,73 +814,1726 @@ NaiveResult solveDP(const std::vector<flowshop::Job>& allJobs,
     return result;
 }
 
-long long solveNaive(const std::vector<flowshop::Job>& allJobs, 
-                   const std::vector<int>& outsourcingCosts, 
-                   int m, int U) {
-    return solveNaiveDetailed(allJobs, outsourcingCosts, m, U).objective;
-}
+// Rows 1..n of the DP into ws: afterwards ws.prevRow holds dp[n][0..U] and
+// ws.decisions every cell's choice.
+static void runDPRows(const std::vector<flowshop::Job>& allJobs,
+                      const std::vector<int>& outsourcingCosts,
+                      int m, int U,
+                      SolverWorkspace& ws,
+                      BlackBoxCache* cache) {
+    const int n = static_cast<int>(allJobs.size());
+    checkDPInput(allJobs, outsourcingCosts, U);
 
-NaiveResult solveNaiveDetailed(const std::vector<flowshop::Job>& allJobs,
-                              const std::vector<int>& outsourcingCosts,
-                              int m, int U) {
+    // Rolling objective rows (dp[i-1][*] and dp[i][*]) + one decision bit per cell.
+    ws.prevRow.resize(static_cast<size_t>(U) + 1);
+    ws.curRow.resize(static_cast<size_t>(U) + 1);
+    ws.decisions.reset(n, U);
 
-    const int n = static_cast<int>(allJobs.size());
-    if (n != static_cast<int>(outsourcingCosts.size())) {
-        throw std::invalid_argument("outsourcingCosts size must match allJobs size");
-    }
-    if (n >= 63) {
-        throw std::invalid_argument("solveNaiveDetailed supports up to 62 jobs (bitmask brute force)");
+    // Base: with 0 jobs, objective is 0 for any allowed budget.
+    std::fill(ws.prevRow.begin(), ws.prevRow.end(), 0LL);
+
+    ws.keepList.reserve(n);
+    ws.keepIndices.reserve(n);
+    const flowshop::WSPTOrder order(allJobs);
+    ws.sets.reset(U, inhouseBoundApplies(order));
+
+    for (int i = 1; i <= n; ++i) {
+        computeDPColumns(i, 0, U + 1, ws.prevRow, ws.curRow, ws.decisions,
+                         outsourcingCosts, order, m, ws.keepList, ws.keepIndices, cache, ws.context,
+                         &ws.sets);
+        ws.prevRow.swap(ws.curRow);
+        ws.sets.swapRows();
     }
+}
 
-    NaiveResult best;
-    best.objective = std::numeric_limits<long long>::max();
-    best.outsourcingCost = 0;
+static NaiveResult solveDPWith(const std::vector<flowshop::Job>& allJobs,
+                               const std::vector<int>& outsourcingCosts,
+                               int m, int U,
+                               SolverWorkspace& ws,
+                               BlackBoxCache* cache) {
+    runDPRows(allJobs, outsourcingCosts, m, U, ws, cache);
 
-    const unsigned long long totalMasks = 1ULL << n;
-    for (unsigned long long mask = 0; mask < totalMasks; ++mask) {
-        std::vector<flowshop::Job> currentA;
-        std::vector<flowshop::Job> currentOut;
-        long long currentOutsourceCost = 0;
+    // dp[n][U] already represents best objective with outsourcing budget <= U
+    return dpResultFromDecisions(allJobs, outsourcingCosts, m, U, ws.decisions,
+                                 ws.prevRow[U], cache);
+}
 
-        currentA.reserve(n);
-        currentOut.reserve(n);
+NaiveResult solveDP(const std::vector<flowshop::Job>& allJobs,
+                    const std::vector<int>& outsourcingCosts,
+                    int m, int U,
+                    BlackBoxCache* cache) {
+    // Repeated in-house sets are already answered by ws.sets, so a private
+    // cache would only ever miss: none unless the caller shares one.
+    SolverWorkspace ws;
+    ws.beginInstance();
+    return solveDPWith(allJobs, outsourcingCosts, m, U, ws, cache);
+}
 
-        for (int j = 0; j < n; ++j) {
-            if ((mask >> j) & 1ULL) {
-                currentA.push_back(allJobs[j]);
-            } else {
-                currentOut.push_back(allJobs[j]);
-                currentOutsourceCost += outsourcingCosts[j];
-            }
-        }
+NaiveResult solveDP(const std::vector<flowshop::Job>& allJobs,
+                    const std::vector<int>& outsourcingCosts,
+                    int m, int U,
+                    SolverWorkspace& ws) {
+    ws.beginInstance();
+    return solveDPWith(allJobs, outsourcingCosts, m, U, ws, nullptr);
+}
 
-        if (currentOutsourceCost > U) continue;
+// --- Whole-budget curve from one DP run ---
+// dp[n][c] for every c in 0..U comes out of a single solveDP pass, and no cell
+// depends on the cap U, so dpObjectiveAt(c) is exactly solveDP(allJobs, costs,
+// m, c).objective. The DP is a heuristic and dp[n][c] can rise with c, so
+// budget c is answered with the best budget c' <= c (any set that fits c'
+// also fits c): objectiveAt, the sets and resultAt all resolve to that c'.
+// The decision bits are kept as back pointers; sets and results are only
+// rebuilt for the budgets asked about.
+class DPBudgetCurve {
+public:
+    int budget() const { return U_; }
 
-        long long obj = 0;
-        std::vector<flowshop::Job> order;
-        if (!currentA.empty()) {
-            flowshop::Solution sol = getSolutionOnly(currentA, m);
-            obj = sol.objective;
-            order = std::move(sol.sequence);
+    // min over c' <= c of dp[n][c']: best objective with outsourcing cost <= c
+    // (non-increasing in c).
+    long long objectiveAt(int c) const { return lastRow_[bestBudgetAt(c)]; }
+    std::vector<long long> objectives() const {
+        std::vector<long long> values(static_cast<size_t>(U_) + 1);
+        for (int c = 0; c <= U_; ++c) values[c] = lastRow_[bestBudget_[c]];
+        return values;
+    }
+
+    // dp[n][c] itself, the same as solveDP(..., c).objective.
+    long long dpObjectiveAt(int c) const { return lastRow_[checkBudget(c)]; }
+
+    // Smallest budget c' <= c whose dp[n][c'] reaches objectiveAt(c).
+    int bestBudgetAt(int c) const { return bestBudget_[checkBudget(c)]; }
+
+    // Budgets where objectiveAt strictly drops (0 is always included): the
+    // points (cost cap, objective) of the curve not dominated by another one.
+    std::vector<int> breakpoints() const {
+        std::vector<int> points;
+        for (int c = 0; c <= U_; ++c) {
+            if (bestBudget_[c] == c) points.push_back(c);
         }
+        return points;
+    }
 
-        if (obj < best.objective) {
-            best.objective = obj;
-            best.inhouseOrder = std::move(order);
-            best.outsourced = std::move(currentOut);
-            best.outsourcingCost = currentOutsourceCost;
+    // In-house jobs at budget c, in job index order (no black-box call).
+    std::vector<flowshop::Job> inhouseAt(int c) const {
+        std::vector<flowshop::Job> inhouse;
+        decisions_.collectInhouse(static_cast<int>(jobs_.size()), bestBudgetAt(c), jobs_, costs_, inhouse);
+        return inhouse;
+    }
+
+    // Outsourced jobs at budget c, in job index order (no black-box call).
+    std::vector<flowshop::Job> outsourcedAt(int c) const {
+        std::vector<flowshop::Job> outsourced;
+        int budget = bestBudgetAt(c);
+        for (int row = static_cast<int>(jobs_.size()); row >= 1; --row) {
+            if (decisions_.outsourced(row, budget)) {
+                outsourced.push_back(jobs_[row - 1]);
+                budget -= costs_[row - 1];
+            }
         }
+        std::reverse(outsourced.begin(), outsourced.end());
+        return outsourced;
     }
 
-    if (best.objective == std::numeric_limits<long long>::max()) {
-        // No feasible solution (shouldn't happen unless U < 0)
-        best.objective = 0;
-        best.inhouseOrder.clear();
-        best.outsourced = allJobs;
-        best.outsourcingCost = std::accumulate(outsourcingCosts.begin(), outsourcingCosts.end(), 0LL);
+    // Full solveDP result at budget bestBudgetAt(c) (one black-box call for the
+    // in-house order); its objective is objectiveAt(c).
+    NaiveResult resultAt(int c) const {
+        const int best = bestBudgetAt(c);
+        return dpResultFromDecisions(jobs_, costs_, m_, best, decisions_, lastRow_[best], nullptr);
     }
 
+private:
+    friend DPBudgetCurve solveDPCurve(const std::vector<flowshop::Job>& allJobs,
+                                      const std::vector<int>& outsourcingCosts,
+                                      int m, int U);
+
+    DPBudgetCurve(std::vector<flowshop::Job> jobs, std::vector<int> costs, int m, int U,
+                  std::vector<long long> lastRow, DPDecisionTable decisions)
+        : jobs_(std::move(jobs)), costs_(std::move(costs)), m_(m), U_(U),
+          lastRow_(std::move(lastRow)), decisions_(std::move(decisions)) {
+        bestBudget_.resize(static_cast<size_t>(U_) + 1);
+        int best = 0;
+        for (int c = 0; c <= U_; ++c) {
+            if (lastRow_[c] < lastRow_[best]) best = c;
+            bestBudget_[c] = best;
+        }
+    }
+
+    int checkBudget(int c) const {
+        if (c < 0 || c > U_) throw std::out_of_range("budget outside 0..U of the DP curve");
+        return c;
+    }
+
+    std::vector<flowshop::Job> jobs_;
+    std::vector<int> costs_;
+    int m_;
+    int U_;
+    std::vector<long long> lastRow_;
+    std::vector<int> bestBudget_;   // bestBudget_[c] = bestBudgetAt(c)
+    DPDecisionTable decisions_;
+};
+
+// One DP pass up to the largest budget of interest; query any c <= U afterwards.
+DPBudgetCurve solveDPCurve(const std::vector<flowshop::Job>& allJobs,
+                           const std::vector<int>& outsourcingCosts,
+                           int m, int U) {
+    SolverWorkspace ws;
+    ws.beginInstance();
+    runDPRows(allJobs, outsourcingCosts, m, U, ws, nullptr);
+    return DPBudgetCurve(allJobs, outsourcingCosts, m, U, std::move(ws.prevRow),
+                         std::move(ws.decisions));
+}
+
+// --- Sparse DP over the (outsourcing cost, objective) Pareto frontier ---
+// Row i holds only non-dominated states of the first i jobs: a state is dropped
+// when another one in the row costs no more and has an objective no larger.
+// Nothing is allocated per budget value, so the work scales with the number of
+// useful trade-offs instead of with U (use it when U is large, e.g. costs in
+// cents). Like solveDP, a state's in-house set is reached through back-pointers
+// and the keep branch evaluates that set plus job i with the black box.
+// The result can differ from solveDP's, either way: the black box is not
+// monotone, so a dropped set can still be the better one to extend by later
+// jobs, and solveDP (one set per budget column) keeps other sets than this
+// frontier does.
+struct ParetoState {
+    long long cost = 0;        // exact outsourcing cost of this state's choice
+    long long objective = 0;   // black-box objective of its in-house set
+    int parent = -1;           // state index in the previous row
+    bool outsourced = false;   // decision for this row's job
+};
+
+// In-house job indices of `state` (row `row`), in reverse index order.
+static void collectParetoIndices(const std::vector<ParetoState>& states, int state, int row,
+                                 std::vector<int>& out) {
+    out.clear();
+    for (; row >= 1; --row) {
+        const ParetoState& st = states[state];
+        if (!st.outsourced) out.push_back(row - 1);
+        state = st.parent;
+    }
+}
+
+// In-house jobs of `state` (row `row`), in job index order.
+static void collectParetoInhouse(const std::vector<ParetoState>& states, int state, int row,
+                                 const std::vector<flowshop::Job>& allJobs,
+                                 std::vector<flowshop::Job>& out) {
+    out.clear();
+    for (; row >= 1; --row) {
+        const ParetoState& st = states[state];
+        if (!st.outsourced) out.push_back(allJobs[row - 1]);
+        state = st.parent;
+    }
+    std::reverse(out.begin(), out.end());
+}
+
+NaiveResult solveDPPareto(const std::vector<flowshop::Job>& allJobs,
+                          const std::vector<int>& outsourcingCosts,
+                          int m, int U) {
+    const int n = static_cast<int>(allJobs.size());
+    checkDPInput(allJobs, outsourcingCosts, U);
+
+    // All rows live in one array; row i is states[rowStart[i] .. rowStart[i+1]),
+    // sorted by increasing cost with strictly decreasing objective.
+    std::vector<ParetoState> states;
+    std::vector<size_t> rowStart;
+    rowStart.reserve(n + 2);
+    rowStart.push_back(0);
+    states.push_back(ParetoState{});    // row 0: nothing outsourced, objective 0
+    rowStart.push_back(states.size());
+
+    std::vector<ParetoState> keepCandidates;
+    std::vector<ParetoState> outCandidates;
+    std::vector<flowshop::Job> keepList;
+    keepList.reserve(n);
+    std::vector<int> keepIndices;
+    keepIndices.reserve(n);
+    flowshop::SolverContext ctx;
+    const flowshop::WSPTOrder order(allJobs);
+
+    for (int i = 1; i <= n; ++i) {
+        const size_t begin = rowStart[i - 1];
+        const size_t end = rowStart[i];
+        const long long u_i = outsourcingCosts[i - 1];
+
+        keepCandidates.clear();
+        outCandidates.clear();
+        FLOWSHOP_COUNT(DPCells, end - begin);
+        for (size_t s = begin; s < end; ++s) {
+            const ParetoState parent = states[s];
+
+            collectParetoIndices(states, static_cast<int>(s), i - 1, keepIndices);
+            keepIndices.push_back(i - 1);
+            const long long keepObj = getObjectiveOnly(order, keepIndices, m, nullptr, keepList, ctx);
+            keepCandidates.push_back(ParetoState{parent.cost, keepObj, static_cast<int>(s), false});
+
+            if (parent.cost + u_i <= U) {
+                outCandidates.push_back(ParetoState{parent.cost + u_i, parent.objective,
+                                                    static_cast<int>(s), true});
+            }
+        }
+
+        // Both candidate lists are sorted by cost: merge them, keeping only
+        // states that strictly improve the objective of every cheaper state.
+        // Equal cost and objective prefers keep-in-house, as solveDP does.
+        size_t a = 0, b = 0;
+        long long bestSoFar = DP_INF;
+        while (a < keepCandidates.size() || b < outCandidates.size()) {
+            const bool takeKeep = b >= outCandidates.size() ||
+                (a < keepCandidates.size() &&
+                 (keepCandidates[a].cost < outCandidates[b].cost ||
+                  (keepCandidates[a].cost == outCandidates[b].cost &&
+                   keepCandidates[a].objective <= outCandidates[b].objective)));
+            const ParetoState cand = takeKeep ? keepCandidates[a++] : outCandidates[b++];
+            if (cand.objective < bestSoFar) {
+                bestSoFar = cand.objective;
+                states.push_back(cand);
+            }
+        }
+        rowStart.push_back(states.size());
+    }
+
+    // The last frontier state has the smallest objective (and the lowest cost among them).
+    const int bestState = static_cast<int>(rowStart[n + 1]) - 1;
+
+    NaiveResult result;
+    std::vector<flowshop::Job> inhouseJobs;
+    collectParetoInhouse(states, bestState, n, allJobs, inhouseJobs);
+
+    result.objective = states[bestState].objective;
+    if (!inhouseJobs.empty()) {
+        flowshop::Solution sol = getSolutionOnly(inhouseJobs, m);
+        result.objective = sol.objective;
+        result.inhouseOrder = std::move(sol.sequence);
+    }
+
+    int state = bestState;
+    for (int row = n; row >= 1; --row) {
+        if (states[state].outsourced) {
+            result.outsourced.push_back(allJobs[row - 1]);
+            result.outsourcingCost += outsourcingCosts[row - 1];
+        }
+        state = states[state].parent;
+    }
+    std::reverse(result.outsourced.begin(), result.outsourced.end());
+    return result;
+}
+
+// NaiveResult for the in-house set kept[idx] != 0 (sequence re-solved once).
+static NaiveResult resultFromKept(const std::vector<flowshop::Job>& allJobs,
+                                  const std::vector<int>& outsourcingCosts,
+                                  int m, const std::vector<char>& kept,
+                                  BlackBoxCache* cache = nullptr) {
+    const int n = static_cast<int>(allJobs.size());
+    NaiveResult result;
+    std::vector<flowshop::Job> inhouseJobs;
+    inhouseJobs.reserve(n);
+    for (int idx = 0; idx < n; ++idx) {
+        if (kept[idx]) {
+            inhouseJobs.push_back(allJobs[idx]);
+        } else {
+            result.outsourced.push_back(allJobs[idx]);
+            result.outsourcingCost += outsourcingCosts[idx];
+        }
+    }
+    if (!inhouseJobs.empty()) {
+        flowshop::Solution sol = getSolutionOnly(inhouseJobs, m, cache);
+        result.objective = sol.objective;
+        result.inhouseOrder = std::move(sol.sequence);
+    }
+    return result;
+}
+
+// --- Approximate DP by cost scaling ---
+// For budgets too large for a dense (or even Pareto) DP. With scale
+// K = max(1, floor(epsilon * U / n)) every cost is rounded up to ceil(u / K),
+// so the DP has about n / epsilon columns whatever U is. Rounding up loses up
+// to n * K of budget: a set of true cost <= U can need up to floor(U / K) + n
+// scaled units. So the DP runs up to that column, and the answer is the best
+// column whose set (walked back from the decision bits) still costs at most U
+// with the true costs. Every column up to floor(U / K) qualifies, so every set
+// of true cost <= U - n * K is still searched (guaranteedBudget), and the
+// budget is never exceeded.
+//
+// There is no objective ratio against solveDP: solveDP is itself a heuristic
+// over a non-monotone black box, and the rounded grid can miss the set it
+// finds. When the exact DP is cheap ((U + 1) * n <= exactCellLimit cells)
+// solveDP is run too and the better result kept (exactDP), so the result is
+// never worse than solveDP there. The report also gives a provable lower
+// bound on the objective of any feasible set (outsourcingLowerBound) and the
+// gap of the returned objective against it.
+struct ApproxDPReport {
+    long long scale = 1;               // K
+    int scaledBudget = 0;              // floor(U / K): columns up to here always fit U
+    long long guaranteedBudget = 0;    // max(0, U - n * K)
+    bool exactDP = false;              // never worse than solveDP (K = 1, or solveDP also ran)
+    long long lowerBound = 0;          // outsourcingLowerBound(...)
+    double gap = 0.0;                  // (objective - lowerBound) / objective, 0 when objective is 0
+};
+
+// Default exactCellLimit of solveDPApprox.
+constexpr long long kApproxExactCells = 1LL << 16;
+
+// Exact ratio arithmetic for the bounds and the greedy order below: 128-bit
+// intermediates, a GCC / Clang extension (__extension__ keeps -pedantic quiet).
+__extension__ typedef __int128 WideInt;
+
+static WideInt wideMul(long long a, long long b) { return static_cast<WideInt>(a) * b; }
+
+// a / ua < b / ub for ua, ub > 0, without rounding.
+static bool ratioLess(WideInt a, long long ua, WideInt b, long long ub) { return a * ub < b * ua; }
+
+// floor(a * num / den) for den > 0; the result must fit a long long.
+static long long mulDiv(long long a, long long num, long long den) {
+    return static_cast<long long>(wideMul(a, num) / den);
+}
+
+// Lower bound on sum w_j C_j over every in-house set whose outsourced cost
+// fits in U (p > 0 and w >= 0; returns 0 for other inputs). Any sequence has
+// C_j >= P_j + (m-1) p_j, so a set S costs at least m * sum w p plus the
+// single-machine Smith pair terms min(w_a p_b, w_b p_a) inside S. The kept
+// set must cover need = sum u - U units of u; it has at least s jobs of
+// positive u (s = fewest jobs reaching need), so each such job x is charged
+// 2 m w_x p_x plus its s-1 smallest pair terms, and the bound is half the
+// fractional covering LP over those charges (the branch-and-bound root bound).
+// O(n^2) time, O(n) memory.
+long long outsourcingLowerBound(const std::vector<flowshop::Job>& allJobs,
+                                const std::vector<int>& outsourcingCosts,
+                                int m, int U) {
+    const int n = static_cast<int>(allJobs.size());
+    checkDPInput(allJobs, outsourcingCosts, U);
+    for (const auto& job : allJobs) {
+        if (job.p <= 0 || job.w < 0) return 0;
+    }
+
+    long long need = std::accumulate(outsourcingCosts.begin(), outsourcingCosts.end(), 0LL) - U;
+    if (need <= 0) return 0;
+
+    std::vector<int> cover;
+    cover.reserve(n);
+    for (int x = 0; x < n; ++x) {
+        if (outsourcingCosts[x] > 0) cover.push_back(x);
+    }
+    std::vector<int> byCost = cover;
+    std::sort(byCost.begin(), byCost.end(), [&](int a, int b) {
+        return outsourcingCosts[a] > outsourcingCosts[b];
+    });
+    int s = 0;
+    for (long long reach = 0; reach < need; ++s) reach += outsourcingCosts[byCost[s]];
+
+    const long long mLong = static_cast<long long>(m);
+    std::vector<long long> charge(n, 0);
+    std::vector<long long> terms;
+    terms.reserve(cover.size());
+    for (int x : cover) {
+        terms.clear();
+        for (int y : cover) {
+            if (y == x) continue;
+            terms.push_back(std::min(allJobs[x].w * allJobs[y].p, allJobs[y].w * allJobs[x].p));
+        }
+        const size_t take = static_cast<size_t>(s - 1);
+        std::nth_element(terms.begin(), terms.begin() + take, terms.end());
+        charge[x] = 2 * mLong * allJobs[x].w * allJobs[x].p +
+                    std::accumulate(terms.begin(), terms.begin() + take, 0LL);
+    }
+
+    std::sort(cover.begin(), cover.end(), [&](int a, int b) {
+        return ratioLess(charge[a], outsourcingCosts[a], charge[b], outsourcingCosts[b]);
+    });
+    long long bound2 = 0;
+    for (int x : cover) {
+        if (need <= outsourcingCosts[x]) {
+            bound2 += mulDiv(charge[x], need, outsourcingCosts[x]);
+            break;
+        }
+        bound2 += charge[x];
+        need -= outsourcingCosts[x];
+    }
+    return bound2 / 2;
+}
+
+NaiveResult solveDPApprox(const std::vector<flowshop::Job>& allJobs,
+                          const std::vector<int>& outsourcingCosts,
+                          int m, int U, double epsilon,
+                          ApproxDPReport* report = nullptr,
+                          long long exactCellLimit = kApproxExactCells) {
+    const int n = static_cast<int>(allJobs.size());
+    checkDPInput(allJobs, outsourcingCosts, U);
+    if (!(epsilon > 0.0 && epsilon < 1.0)) {
+        throw std::invalid_argument("epsilon must be in (0, 1)");
+    }
+
+    const long long K = n == 0 ? 1
+        : std::max(1LL, static_cast<long long>(std::floor(epsilon * U / n)));
+    const int scaledU = static_cast<int>(U / K);
+    std::vector<int> scaledCosts(n);
+    for (int i = 0; i < n; ++i) {
+        scaledCosts[i] = static_cast<int>((outsourcingCosts[i] + K - 1) / K);
+    }
+    // Past sum ceil(u / K) no column adds a set.
+    const long long scaledTotal = std::accumulate(scaledCosts.begin(), scaledCosts.end(), 0LL);
+    const int columns = static_cast<int>(
+        std::max<long long>(scaledU, std::min<long long>(static_cast<long long>(scaledU) + n, scaledTotal)));
+
+    SolverWorkspace ws;
+    ws.beginInstance();
+    runDPRows(allJobs, scaledCosts, m, columns, ws, nullptr);
+
+    // Best column whose set fits U with the true costs (dp[n][c] is that set's
+    // objective); ties to the smallest column.
+    const long long total = std::accumulate(outsourcingCosts.begin(), outsourcingCosts.end(), 0LL);
+    std::vector<int> inhouse;
+    int best = 0;
+    for (int c = 1; c <= columns; ++c) {
+        if (ws.prevRow[c] >= ws.prevRow[best]) continue;
+        if (c > scaledU) {
+            ws.decisions.collectInhouseIndices(n, c, scaledCosts, inhouse);
+            long long cost = total;
+            for (int idx : inhouse) cost -= outsourcingCosts[idx];
+            if (cost > U) continue;
+        }
+        best = c;
+    }
+
+    // Walk back on the scaled costs, price the result with the real ones.
+    ws.decisions.collectInhouseIndices(n, best, scaledCosts, inhouse);
+    std::vector<char> kept(n, 0);
+    for (int idx : inhouse) kept[idx] = 1;
+    NaiveResult result = resultFromKept(allJobs, outsourcingCosts, m, kept);
+
+    const bool exact = K > 1 && (static_cast<long long>(U) + 1) * n <= exactCellLimit;
+    if (exact) {
+        NaiveResult dp = solveDP(allJobs, outsourcingCosts, m, U);
+        if (dp.objective < result.objective) result = std::move(dp);
+    }
+
+    if (report) {
+        report->scale = K;
+        report->scaledBudget = scaledU;
+        report->guaranteedBudget = std::max(0LL, static_cast<long long>(U) - n * K);
+        // With K = 1 the grid is exact and column U is solveDP's own answer.
+        report->exactDP = exact || K == 1;
+        report->lowerBound = outsourcingLowerBound(allJobs, outsourcingCosts, m, U);
+        report->gap = result.objective == 0 ? 0.0
+            : static_cast<double>(result.objective - report->lowerBound) / static_cast<double>(result.objective);
+    }
+    return result;
+}
+
+long long solveNaive(const std::vector<flowshop::Job>& allJobs, 
+                   const std::vector<int>& outsourcingCosts, 
+                   int m, int U) {
+    return solveNaiveDetailed(allJobs, outsourcingCosts, m, U).objective;
+}
+
+// Expand the winning in-house mask into a NaiveResult (sequence re-solved once).
+static NaiveResult naiveResultFromMask(const std::vector<flowshop::Job>& allJobs,
+                                       const std::vector<int>& outsourcingCosts,
+                                       int m, bool found, long long bestObj,
+                                       unsigned long long bestMask,
+                                       BlackBoxCache* cache = nullptr) {
+    const int n = static_cast<int>(allJobs.size());
+    NaiveResult best;
+    if (!found) {
+        // No feasible solution (shouldn't happen unless U < 0)
+        best.objective = 0;
+        best.outsourced = allJobs;
+        best.outsourcingCost = std::accumulate(outsourcingCosts.begin(), outsourcingCosts.end(), 0LL);
+        return best;
+    }
+
+    std::vector<flowshop::Job> inhouse;
+    inhouse.reserve(n);
+    for (int j = 0; j < n; ++j) {
+        if ((bestMask >> j) & 1ULL) {
+            inhouse.push_back(allJobs[j]);
+        } else {
+            best.outsourced.push_back(allJobs[j]);
+            best.outsourcingCost += outsourcingCosts[j];
+        }
+    }
+
+    best.objective = bestObj;
+    if (!inhouse.empty()) {
+        flowshop::Solution sol = getSolutionOnly(inhouse, m, cache);
+        best.objective = sol.objective;
+        best.inhouseOrder = std::move(sol.sequence);
+    }
     return best;
 }
 
+// Gray-code walk: step k toggles job ctz(k), so the outsourcing cost changes by
+// one u_j. Masks over budget are rejected before any list is built, the
+// in-house buffer is reused, and only the winning mask is re-solved for its
+// sequence and outsourced list. The in-house lower bound follows the same
+// toggles, and a mask whose bound is above the best so far is skipped too.
+static NaiveResult solveNaiveGray(const std::vector<flowshop::Job>& allJobs,
+                                  const std::vector<int>& outsourcingCosts,
+                                  int m, int U,
+                                  BlackBoxCache* cache,
+                                  std::vector<flowshop::Job>& currentA,
+                                  flowshop::SolverContext& ctx) {
+    const int n = static_cast<int>(allJobs.size());
+
+    // Start from mask 0: every job outsourced.
+    long long cost = std::accumulate(outsourcingCosts.begin(), outsourcingCosts.end(), 0LL);
+    unsigned long long mask = 0;
+
+    bool found = false;
+    long long bestObj = 0;
+    unsigned long long bestMask = 0;
+
+    currentA.reserve(n);
+    const flowshop::WSPTOrder order(allJobs);
+    const bool bounded = inhouseBoundApplies(order);
+    InhouseBoundTracker bound(order, m);
+
+    const unsigned long long totalMasks = 1ULL << n;
+    for (unsigned long long step = 0; step < totalMasks; ++step) {
+        if (step > 0) {
+            const int j = __builtin_ctzll(step);
+            mask ^= 1ULL << j;
+            const bool kept = (mask >> j) & 1ULL;
+            cost += kept ? -outsourcingCosts[j] : outsourcingCosts[j];
+            if (bounded) {
+                if (kept) {
+                    bound.add(j);
+                } else {
+                    bound.remove(j);
+                }
+            }
+        }
+
+        if (cost > U) {
+            FLOWSHOP_COUNT(NaiveMasksSkipped, 1);
+            continue;
+        }
+        // Ties may still win on the mask, so only a bound above the best skips.
+        if (found && bounded && bound.value() > bestObj) {
+            FLOWSHOP_COUNT(BoundPruned, 1);
+            continue;
+        }
+
+        order.subsetInOrder(mask, currentA);
+        const long long obj = getObjectiveOnly(order, currentA, m, cache, ctx);
+        if (!found || obj < bestObj || (obj == bestObj && mask < bestMask)) {
+            found = true;
+            bestObj = obj;
+            bestMask = mask;
+        }
+    }
+
+    return naiveResultFromMask(allJobs, outsourcingCosts, m, found, bestObj, bestMask, cache);
+}
+
+// (outsourcing cost, in-house mask) of every subset of jobs [first, first+count),
+// walked in Gray order so each cost is one update away from the previous one.
+// Mask bits stay at the jobs' own positions, so two halves combine with |.
+static void enumerateHalf(const std::vector<int>& outsourcingCosts, int first, int count,
+                          std::vector<std::pair<long long, unsigned long long>>& out) {
+    long long cost = 0;
+    for (int j = first; j < first + count; ++j) cost += outsourcingCosts[j];
+    unsigned long long mask = 0;
+
+    const unsigned long long total = 1ULL << count;
+    out.clear();
+    out.reserve(total);
+    for (unsigned long long step = 0; step < total; ++step) {
+        if (step > 0) {
+            const int j = first + __builtin_ctzll(step);
+            mask ^= 1ULL << j;
+            cost += ((mask >> j) & 1ULL) ? -outsourcingCosts[j] : outsourcingCosts[j];
+        }
+        out.emplace_back(cost, mask);
+    }
+}
+
+// Split-half walk: the low and high halves are enumerated once each (2^(n/2)
+// costs apiece), the high half is sorted by cost, and every low subset with
+// cost c only pairs with the high prefix of cost <= U - c. Over-budget masks
+// are never formed, so tight budgets touch a small fraction of the 2^n.
+// Same tie rule as the Gray walk (smallest mask), hence the same result.
+static NaiveResult solveNaiveSplitHalf(const std::vector<flowshop::Job>& allJobs,
+                                       const std::vector<int>& outsourcingCosts,
+                                       int m, int U,
+                                       BlackBoxCache* cache,
+                                       std::vector<flowshop::Job>& currentA,
+                                       flowshop::SolverContext& ctx) {
+    const int n = static_cast<int>(allJobs.size());
+    const int low = n / 2;
+
+    std::vector<std::pair<long long, unsigned long long>> lowHalf, highHalf;
+    enumerateHalf(outsourcingCosts, 0, low, lowHalf);
+    enumerateHalf(outsourcingCosts, low, n - low, highHalf);
+    std::sort(highHalf.begin(), highHalf.end());
+
+    bool found = false;
+    long long bestObj = 0;
+    unsigned long long bestMask = 0;
+
+    currentA.reserve(n);
+    const flowshop::WSPTOrder order(allJobs);
+
+    for (const auto& [lowCost, lowMask] : lowHalf) {
+        if (lowCost > U) {
+            FLOWSHOP_COUNT(NaiveMasksSkipped, highHalf.size());
+            continue;
+        }
+        const auto end = std::upper_bound(highHalf.begin(), highHalf.end(),
+                                          std::make_pair(U - lowCost, ~0ULL));
+        FLOWSHOP_COUNT(NaiveMasksSkipped, highHalf.end() - end);
+        for (auto it = highHalf.begin(); it != end; ++it) {
+            const unsigned long long mask = lowMask | it->second;
+            order.subsetInOrder(mask, currentA);
+            const long long obj = getObjectiveOnly(order, currentA, m, cache, ctx);
+            if (!found || obj < bestObj || (obj == bestObj && mask < bestMask)) {
+                found = true;
+                bestObj = obj;
+                bestMask = mask;
+            }
+        }
+    }
+
+    return naiveResultFromMask(allJobs, outsourcingCosts, m, found, bestObj, bestMask, cache);
+}
+
+NaiveResult solveNaiveDetailed(const std::vector<flowshop::Job>& allJobs,
+                              const std::vector<int>& outsourcingCosts,
+                              int m, int U,
+                              BlackBoxCache* cache,
+                              NaiveEnumeration enumeration) {
+
+    const int n = static_cast<int>(allJobs.size());
+    if (n != static_cast<int>(outsourcingCosts.size())) {
+        throw std::invalid_argument("outsourcingCosts size must match allJobs size");
+    }
+    if (n >= 63) {
+        throw std::invalid_argument("solveNaiveDetailed supports up to 62 jobs (bitmask brute force)");
+    }
+    if (cache) checkUniqueIds(allJobs);
+
+    if (enumeration == NaiveEnumeration::GrayCode || enumeration == NaiveEnumeration::SplitHalf) {
+        std::vector<flowshop::Job> currentA;
+        flowshop::SolverContext ctx;
+        if (enumeration == NaiveEnumeration::SplitHalf) {
+            return solveNaiveSplitHalf(allJobs, outsourcingCosts, m, U, cache, currentA, ctx);
+        }
+        return solveNaiveGray(allJobs, outsourcingCosts, m, U, cache, currentA, ctx);
+    }
+
+    NaiveResult best;
+    best.objective = std::numeric_limits<long long>::max();
+    best.outsourcingCost = 0;
+
+    const unsigned long long totalMasks = 1ULL << n;
+    for (unsigned long long mask = 0; mask < totalMasks; ++mask) {
+        std::vector<flowshop::Job> currentA;
+        std::vector<flowshop::Job> currentOut;
+        long long currentOutsourceCost = 0;
+
+        currentA.reserve(n);
+        currentOut.reserve(n);
+
+        for (int j = 0; j < n; ++j) {
+            if ((mask >> j) & 1ULL) {
+                currentA.push_back(allJobs[j]);
+            } else {
+                currentOut.push_back(allJobs[j]);
+                currentOutsourceCost += outsourcingCosts[j];
+            }
+        }
+
+        if (currentOutsourceCost > U) {
+            FLOWSHOP_COUNT(NaiveMasksSkipped, 1);
+            continue;
+        }
+
+        long long obj = 0;
+        std::vector<flowshop::Job> order;
+        if (!currentA.empty()) {
+            flowshop::Solution sol = getSolutionOnly(currentA, m, cache);
+            obj = sol.objective;
+            order = std::move(sol.sequence);
+        }
+
+        if (obj < best.objective) {
+            best.objective = obj;
+            best.inhouseOrder = std::move(order);
+            best.outsourced = std::move(currentOut);
+            best.outsourcingCost = currentOutsourceCost;
+        }
+    }
+
+    if (best.objective == std::numeric_limits<long long>::max()) {
+        // No feasible solution (shouldn't happen unless U < 0)
+        best.objective = 0;
+        best.inhouseOrder.clear();
+        best.outsourced = allJobs;
+        best.outsourcingCost = std::accumulate(outsourcingCosts.begin(), outsourcingCosts.end(), 0LL);
+    }
+
+    return best;
+}
+
+// Gray-code naive search with the workspace's buffer (no cache: masks never repeat).
+NaiveResult solveNaiveDetailed(const std::vector<flowshop::Job>& allJobs,
+                              const std::vector<int>& outsourcingCosts,
+                              int m, int U,
+                              SolverWorkspace& ws) {
+    const int n = static_cast<int>(allJobs.size());
+    if (n != static_cast<int>(outsourcingCosts.size())) {
+        throw std::invalid_argument("outsourcingCosts size must match allJobs size");
+    }
+    if (n >= 63) {
+        throw std::invalid_argument("solveNaiveDetailed supports up to 62 jobs (bitmask brute force)");
+    }
+    ws.beginInstance();
+    return solveNaiveGray(allJobs, outsourcingCosts, m, U, nullptr, ws.keepList, ws.context);
+}
+
+// ---------- Instance reduction ----------
+// Decisions that can be made before any search, recorded so the full result
+// (every original job, in-house order and outsourced list) can be rebuilt:
+//   - a job with u > U can never be outsourced: always in-house;
+//   - a job with p = w = 0 adds nothing to any schedule, so keeping it is
+//     never worse than spending budget on it: always in-house;
+//   - free jobs with equal (p, w, u) are interchangeable, so only how many
+//     copies are kept matters: they become one group (a bounded knapsack
+//     item), and keeping k copies always means its first k members;
+//   - the budget is capped at the free jobs' total cost and every cost and
+//     the budget are divided by the costs' gcd.
+// A solve over the reduction searches the groups only; the fixed jobs are
+// added to every black-box set.
+struct InstanceReduction {
+    struct Group {
+        std::vector<int> members;   // job indices, ascending
+        int cost = 0;               // scaled outsourcing cost of one copy
+    };
+
+    int originalU = 0;
+    int U = 0;                      // reduced budget (scaled)
+    int costScale = 1;              // gcd of the free jobs' costs (1 if all zero)
+    std::vector<int> fixedInhouse;  // job indices kept in every solution
+    std::vector<Group> groups;      // free jobs, by first member
+
+    int forcedByBudget = 0;         // jobs with u > U
+    int forcedZero = 0;             // jobs with p = w = 0
+    int mergedJobs = 0;             // copies folded into an earlier identical job
+};
+
+InstanceReduction reduceInstance(const std::vector<flowshop::Job>& allJobs,
+                                 const std::vector<int>& outsourcingCosts,
+                                 int U) {
+    const int n = static_cast<int>(allJobs.size());
+    checkDPInput(allJobs, outsourcingCosts, U);
+
+    InstanceReduction r;
+    r.originalU = U;
+
+    std::map<std::tuple<long long, long long, int>, int> groupOf;   // (p, w, u) -> group
+
+    long long freeTotal = 0;
+    int scale = 0;
+    for (int i = 0; i < n; ++i) {
+        const auto& job = allJobs[i];
+        const int u = outsourcingCosts[i];
+        if (u > U) {
+            r.fixedInhouse.push_back(i);
+            ++r.forcedByBudget;
+            continue;
+        }
+        if (job.p == 0 && job.w == 0) {
+            r.fixedInhouse.push_back(i);
+            ++r.forcedZero;
+            continue;
+        }
+        const auto key = std::make_tuple(job.p, job.w, u);
+        auto it = groupOf.find(key);
+        if (it == groupOf.end()) {
+            groupOf.emplace(key, static_cast<int>(r.groups.size()));
+            r.groups.push_back(InstanceReduction::Group{{i}, u});
+        } else {
+            r.groups[it->second].members.push_back(i);
+            ++r.mergedJobs;
+        }
+        freeTotal += u;
+        scale = std::gcd(scale, u);
+    }
+
+    r.costScale = std::max(scale, 1);
+    r.U = static_cast<int>(std::min<long long>(U, freeTotal) / r.costScale);
+    for (auto& g : r.groups) g.cost /= r.costScale;
+    return r;
+}
+
+// Full result when group g outsources outsourcedCopies[g] copies (its last ones).
+NaiveResult expandReduction(const std::vector<flowshop::Job>& allJobs,
+                            const std::vector<int>& outsourcingCosts,
+                            int m, const InstanceReduction& reduction,
+                            const std::vector<int>& outsourcedCopies,
+                            BlackBoxCache* cache = nullptr) {
+    std::vector<char> kept(allJobs.size(), 0);
+    for (int idx : reduction.fixedInhouse) kept[idx] = 1;
+    for (size_t g = 0; g < reduction.groups.size(); ++g) {
+        const auto& members = reduction.groups[g].members;
+        const size_t keep = members.size() - static_cast<size_t>(outsourcedCopies[g]);
+        for (size_t k = 0; k < keep; ++k) kept[members[k]] = 1;
+    }
+    return resultFromKept(allJobs, outsourcingCosts, m, kept, cache);
+}
+
+// Fixed jobs plus the first (size - outsourced) members of every group.
+static void reducedInhouseIndices(const InstanceReduction& reduction,
+                                  const std::vector<int>& outsourcedCopies,
+                                  std::vector<int>& out) {
+    out.assign(reduction.fixedInhouse.begin(), reduction.fixedInhouse.end());
+    for (size_t g = 0; g < reduction.groups.size(); ++g) {
+        const auto& members = reduction.groups[g].members;
+        const size_t keep = members.size() - static_cast<size_t>(outsourcedCopies[g]);
+        out.insert(out.end(), members.begin(), members.begin() + keep);
+    }
+}
+
+// Exhaustive search over the reduction: every combination of outsourced copy
+// counts (prod (size_g + 1) of them instead of 2^n), walked like an odometer;
+// once a digit's increment goes over budget its larger values are skipped.
+// Same objective as solveNaiveDetailed on the full instance (among equal
+// objectives the in-house set may differ).
+NaiveResult solveNaiveReduced(const std::vector<flowshop::Job>& allJobs,
+                              const std::vector<int>& outsourcingCosts,
+                              int m, const InstanceReduction& reduction,
+                              BlackBoxCache* cache = nullptr) {
+    const size_t groups = reduction.groups.size();
+    double combinations = 1.0;
+    for (const auto& g : reduction.groups) combinations *= static_cast<double>(g.members.size() + 1);
+    if (combinations > static_cast<double>(1ULL << 62)) {
+        throw std::invalid_argument("solveNaiveReduced: too many combinations after reduction");
+    }
+
+    const flowshop::WSPTOrder order(allJobs);
+    flowshop::SolverContext ctx;
+    std::vector<flowshop::Job> scratch;
+    std::vector<int> indices;
+    std::vector<int> digits(groups, 0);
+    std::vector<int> best(groups, 0);
+    long long bestObj = 0;
+    bool found = false;
+    long long cost = 0;
+
+    for (;;) {
+        reducedInhouseIndices(reduction, digits, indices);
+        const long long obj = getObjectiveOnly(order, indices, m, cache, scratch, ctx);
+        if (!found || obj < bestObj) {
+            found = true;
+            bestObj = obj;
+            best = digits;
+        }
+
+        // Next combination within budget; a digit whose increment does not fit
+        // carries at once, since its larger values cost even more.
+        size_t d = 0;
+        for (; d < groups; ++d) {
+            const auto& g = reduction.groups[d];
+            const int size = static_cast<int>(g.members.size());
+            if (digits[d] < size && cost + g.cost <= reduction.U) {
+                ++digits[d];
+                cost += g.cost;
+                break;
+            }
+            cost -= static_cast<long long>(digits[d]) * g.cost;
+            digits[d] = 0;
+        }
+        if (d == groups) break;
+    }
+
+    return expandReduction(allJobs, outsourcingCosts, m, reduction, best, cache);
+}
+
+// The budget DP over the reduction: one row per group, and a row chooses how
+// many copies to outsource (0..size; on ties the fewest, so keeping wins as
+// in solveDP). Row 0 is the fixed set. This is not solveDP behind a
+// reduction pass: when nothing is fixed or merged (the reduction only caps
+// and scales the budget) it is solveDP's recurrence and returns solveDP's
+// result, but fixed jobs sit in every row's set and a group row picks a copy
+// count, so otherwise its rows see other sets than solveDP's and, both being
+// heuristics, the result can differ from solveDP's either way.
+NaiveResult solveDPReduced(const std::vector<flowshop::Job>& allJobs,
+                           const std::vector<int>& outsourcingCosts,
+                           int m, const InstanceReduction& reduction,
+                           BlackBoxCache* cache = nullptr) {
+    const int rows = static_cast<int>(reduction.groups.size());
+    const int U = reduction.U;
+    const size_t width = static_cast<size_t>(U) + 1;
+
+    BlackBoxCache ownCache(m);
+    if (!cache) cache = &ownCache;
+    const flowshop::WSPTOrder order(allJobs);
+    flowshop::SolverContext ctx;
+    std::vector<flowshop::Job> scratch;
+    std::vector<int> indices;
+
+    // choice[(i-1) * width + c] = copies of group i-1 outsourced in dp[i][c].
+    std::vector<int> choice(static_cast<size_t>(rows) * width, 0);
+    std::vector<int> copies(reduction.groups.size(), 0);
+
+    // Outsourced copies per group behind dp[i][c]: groups >= i are not in the
+    // set yet (all "outsourced"), the rest come from walking the choices back.
+    auto collect = [&](int i, int c) {
+        for (size_t g = 0; g < copies.size(); ++g) {
+            copies[g] = static_cast<int>(reduction.groups[g].members.size());
+        }
+        for (int row = i; row >= 1; --row) {
+            const int t = choice[static_cast<size_t>(row - 1) * width + c];
+            copies[row - 1] = t;
+            c -= t * reduction.groups[row - 1].cost;
+        }
+    };
+
+    indices = reduction.fixedInhouse;
+    const long long base = getObjectiveOnly(order, indices, m, cache, scratch, ctx);
+    std::vector<long long> prevRow(width, base);
+    std::vector<long long> curRow(width);
+
+    for (int i = 1; i <= rows; ++i) {
+        const auto& g = reduction.groups[i - 1];
+        const int size = static_cast<int>(g.members.size());
+        for (int c = 0; c <= U; ++c) {
+            long long best = DP_INF;
+            int bestT = 0;
+            for (int t = 0; t <= size && static_cast<long long>(t) * g.cost <= c; ++t) {
+                const int from = c - t * g.cost;
+                long long obj;
+                if (t == size) {
+                    obj = prevRow[from];
+                } else {
+                    collect(i - 1, from);
+                    copies[i - 1] = t;
+                    reducedInhouseIndices(reduction, copies, indices);
+                    obj = getObjectiveOnly(order, indices, m, cache, scratch, ctx);
+                }
+                if (obj < best) {
+                    best = obj;
+                    bestT = t;
+                }
+            }
+            curRow[c] = best;
+            choice[static_cast<size_t>(i - 1) * width + c] = bestT;
+        }
+        FLOWSHOP_COUNT(DPCells, width);
+        prevRow.swap(curRow);
+    }
+
+    collect(rows, U);
+    return expandReduction(allJobs, outsourcingCosts, m, reduction, copies, cache);
+}
+
+// ---------- Cancellation ----------
+// Polled by the anytime solvers between chunks of work. A token fires at a
+// wall-clock deadline, when an external flag is set, or both (whichever comes
+// first); a default token never fires.
+class CancelToken {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    CancelToken() = default;
+    explicit CancelToken(Clock::time_point deadline, const std::atomic<bool>* flag = nullptr)
+        : hasDeadline_(true), deadline_(deadline), flag_(flag) {}
+    explicit CancelToken(const std::atomic<bool>* flag) : flag_(flag) {}
+
+    template <class Rep, class Period>
+    static CancelToken after(std::chrono::duration<Rep, Period> timeout,
+                             const std::atomic<bool>* flag = nullptr) {
+        return CancelToken(Clock::now() + std::chrono::duration_cast<Clock::duration>(timeout), flag);
+    }
+
+    bool cancelled() const {
+        if (flag_ && flag_->load(std::memory_order_relaxed)) return true;
+        return hasDeadline_ && Clock::now() >= deadline_;
+    }
+
+private:
+    bool hasDeadline_ = false;
+    Clock::time_point deadline_{};
+    const std::atomic<bool>* flag_ = nullptr;
+};
+
+// ---------- Exact branch and bound ----------
+// Same answer as solveNaiveDetailed: the smallest black-box objective over all
+// budget-feasible in-house sets, ties to the smallest set as a binary number
+// (highest differing job index kept side loses), but without a 2^n walk and
+// for any n.
+//
+// Search tree: every node is one in-house set K. Jobs are branched on in
+// order of decreasing u (outsourcing them is the fastest way out of budget);
+// node (K, i) has one child per j >= i that keeps order[j] and outsources
+// order[i..j-1]. A node is evaluated by the black box when outsourcing all of
+// order[i..] fits in U, so each set is scored at most once.
+//
+// Bounds (need p > 0, w >= 0):
+//   - feasibility: the cost already outsourced must stay <= U;
+//   - objective: any schedule of a set A has C_r >= P_r + (m-1) * p_r, so
+//     BB(A) >= (m-1) * sum w p + Smith(A), where Smith(A) is the single machine
+//     optimum (WSPT). It only grows with A. Over the completions of K that keep
+//     enough u to fit the budget, this is at least LB(K) plus a fractional
+//     covering LP: each undecided job adds at least its marginal cost against K.
+// The incumbent starts from solveDP; a node is cut when its bound is strictly
+// worse, so equal-objective sets are still reached for the tie rule.
+struct BranchBoundStats {
+    long long nodes = 0;        // search-tree nodes entered
+    long long evaluations = 0;  // black-box calls on a feasible K
+    long long pruned = 0;       // nodes cut by the objective bound
+    bool cancelled = false;     // stopped by a CancelToken before the tree was exhausted
+};
+
+namespace detail {
+
+class BranchAndBound {
+public:
+    BranchAndBound(const std::vector<flowshop::Job>& allJobs,
+                   const std::vector<int>& outsourcingCosts,
+                   int m, int U)
+        : jobs_(allJobs), costs_(outsourcingCosts), m_(m), U_(U),
+          n_(static_cast<int>(allJobs.size())), wspt_(allJobs),
+          words_((n_ + 63) / 64) {
+        order_.resize(n_);
+        std::iota(order_.begin(), order_.end(), 0);
+        std::stable_sort(order_.begin(), order_.end(), [&](int a, int b) {
+            return costs_[a] > costs_[b];
+        });
+        sufU_.assign(n_ + 1, 0);
+        for (int j = n_ - 1; j >= 0; --j) sufU_[j] = sufU_[j + 1] + costs_[order_[j]];
+
+        inK_.assign(n_, 0);
+        kWords_.assign(words_, 0);
+        delta_.assign(n_, 0);
+        childDelta_.assign(static_cast<size_t>(n_ + 1) * n_, 0);
+        cover_.reserve(n_);
+        charge_.assign(n_, 0);
+        subset_.reserve(n_);
+
+        position_.resize(n_);
+        for (int j = 0; j < n_; ++j) position_[order_[j]] = j;
+        partners_.resize(static_cast<size_t>(n_) * std::max(0, n_ - 1));
+        for (int x = 0; x < n_; ++x) {
+            Partner* list = partners_.data() + static_cast<size_t>(x) * (n_ - 1);
+            int t = 0;
+            for (int y = 0; y < n_; ++y) {
+                if (y == x) continue;
+                list[t++] = Partner{y, std::min(jobs_[x].w * jobs_[y].p, jobs_[y].w * jobs_[x].p)};
+            }
+            std::sort(list, list + t, [](const Partner& a, const Partner& b) { return a.term < b.term; });
+        }
+    }
+
+    void setIncumbent(long long objective, const std::vector<std::uint64_t>& set) {
+        found_ = true;
+        bestObj_ = objective;
+        bestWords_ = set;
+    }
+
+    // Polled every 1024 nodes; once it fires the search unwinds and keeps
+    // the incumbent (stats().cancelled is set).
+    void setCancel(const CancelToken* token) { cancel_ = token; }
+
+    void run() { visit(0, 0, 0, 0); }
+
+    bool found() const { return found_; }
+    long long bestObjective() const { return bestObj_; }
+    const std::vector<std::uint64_t>& bestSet() const { return bestWords_; }
+    const BranchBoundStats& stats() const { return stats_; }
+
+private:
+    struct Partner {
+        int job;
+        long long term;   // min(w_x p_y, w_y p_x): Smith cost of the pair
+    };
+
+    // K's set (by job index) is smaller than the incumbent's as a binary number.
+    bool smallerThanBest() const {
+        for (int k = words_ - 1; k >= 0; --k) {
+            if (kWords_[k] != bestWords_[k]) return kWords_[k] < bestWords_[k];
+        }
+        return false;
+    }
+
+    // delta_[x] for every job x not in K: LB(K + x) - LB(K) with K's own jobs only.
+    void marginalCosts() {
+        const long long mLong = static_cast<long long>(m_);
+        long long totalW = 0;
+        for (int x = 0; x < n_; ++x) {
+            if (inK_[x]) totalW += jobs_[x].w;
+        }
+        long long before = 0, beforeW = 0;
+        for (int r = 0; r < n_; ++r) {
+            const int x = wspt_.indexAt(r);
+            const auto& job = jobs_[x];
+            if (inK_[x]) {
+                before += job.p;
+                beforeW += job.w;
+            } else {
+                delta_[x] = job.w * (mLong * job.p + before) + job.p * (totalW - beforeW);
+            }
+        }
+    }
+
+    // Smallest extra bound to keep `need` more units of u among order[i..]
+    // (-1 if even keeping all of them is not enough). Any completion keeps a
+    // set S of these jobs with u(S) >= need, so |S| >= s (order is u
+    // descending) and LB rises by sum_{x in S} delta_x plus the Smith pair
+    // terms min(w_a p_b, w_b p_a) inside S; every x in S has at least s-1 of
+    // them, so x is charged delta_x + half of its s-1 smallest. The bound is
+    // the fractional covering LP over those charges.
+    long long coverBound(int i, long long need) {
+        if (need <= 0) return 0;
+        if (sufU_[i] < need) return -1;
+        cover_.clear();
+        int s = 0;
+        long long reach = 0;
+        for (int j = i; j < n_; ++j) {
+            const int x = order_[j];
+            if (costs_[x] <= 0) continue;
+            cover_.push_back(x);
+            if (reach < need) {
+                reach += costs_[x];
+                ++s;
+            }
+        }
+
+        // charge_[x] = 2 * delta_x + sum of x's s-1 smallest pair terms
+        // (partners_ lists every job's partners by increasing pair term).
+        for (int x : cover_) {
+            long long pairSum = 0;
+            int taken = 0;
+            const Partner* list = partners_.data() + static_cast<size_t>(x) * (n_ - 1);
+            for (int t = 0; t < n_ - 1 && taken < s - 1; ++t) {
+                const int y = list[t].job;
+                if (position_[y] < i || costs_[y] <= 0) continue;
+                pairSum += list[t].term;
+                ++taken;
+            }
+            charge_[x] = 2 * delta_[x] + pairSum;
+        }
+
+        std::sort(cover_.begin(), cover_.end(), [&](int a, int b) {
+            return ratioLess(charge_[a], costs_[a], charge_[b], costs_[b]);
+        });
+        long long bound2 = 0;
+        for (int x : cover_) {
+            if (need <= costs_[x]) {
+                bound2 += mulDiv(charge_[x], need, costs_[x]);
+                break;
+            }
+            bound2 += charge_[x];
+            need -= costs_[x];
+        }
+        return bound2 / 2;
+    }
+
+    void consider(long long objective) {
+        if (!found_ || objective < bestObj_ || (objective == bestObj_ && smallerThanBest())) {
+            found_ = true;
+            bestObj_ = objective;
+            bestWords_ = kWords_;
+        }
+    }
+
+    // K = jobs with inK_ set; order[0..i) decided, `fixed` = their outsourced cost;
+    // lowerK = (m-1) * sum w p + Smith(K), depth = |K|.
+    void visit(int i, long long fixed, long long lowerK, int depth) {
+        ++stats_.nodes;
+        if (cancel_ && (stats_.nodes & 1023) == 0 && cancel_->cancelled()) stats_.cancelled = true;
+        if (stats_.cancelled) return;
+        const long long need = fixed + sufU_[i] - U_;
+
+        marginalCosts();
+        const long long cover = coverBound(i, need);
+        if (cover < 0) return;
+        if (found_ && lowerK + cover > bestObj_) {
+            ++stats_.pruned;
+            return;
+        }
+
+        if (need <= 0) {
+            ++stats_.evaluations;
+            long long objective = 0;
+            bool anyKept = false;
+            for (int x = 0; x < n_ && !anyKept; ++x) anyKept = inK_[x] != 0;
+            if (anyKept) {
+                subset_.clear();
+                for (int r = 0; r < n_; ++r) {
+                    const int x = wspt_.indexAt(r);
+                    if (inK_[x]) subset_.push_back(jobs_[x]);
+                }
+                objective = wspt_.objective(subset_, m_, ctx_);
+            }
+            consider(objective);
+        }
+
+        // delta_ is overwritten by the children; keep what they need
+        // (one row of childDelta_ per tree depth, depth = |K| <= i).
+        long long* childDelta = childDelta_.data() + static_cast<size_t>(depth) * n_;
+        for (int j = i; j < n_; ++j) childDelta[j - i] = delta_[order_[j]];
+
+        long long outsourced = fixed;
+        for (int j = i; j < n_ && outsourced <= U_ && !stats_.cancelled; ++j) {
+            const int x = order_[j];
+            inK_[x] = 1;
+            kWords_[x >> 6] |= 1ULL << (x & 63);
+            visit(j + 1, outsourced, lowerK + childDelta[j - i], depth + 1);
+            kWords_[x >> 6] &= ~(1ULL << (x & 63));
+            inK_[x] = 0;
+            outsourced += costs_[x];
+        }
+    }
+
+    const std::vector<flowshop::Job>& jobs_;
+    const std::vector<int>& costs_;
+    int m_;
+    int U_;
+    int n_;
+    flowshop::WSPTOrder wspt_;
+    int words_;
+
+    std::vector<int> order_;           // branching order (u descending)
+    std::vector<long long> sufU_;      // sufU_[j] = sum of u over order[j..]
+    std::vector<char> inK_;
+    std::vector<std::uint64_t> kWords_;
+    std::vector<long long> delta_;
+    std::vector<long long> childDelta_;
+    std::vector<int> cover_;
+    std::vector<long long> charge_;
+    std::vector<int> position_;         // index of each job in order_
+    std::vector<Partner> partners_;     // n-1 partners per job, by pair term
+    std::vector<flowshop::Job> subset_;
+    flowshop::SolverContext ctx_;
+
+    bool found_ = false;
+    long long bestObj_ = 0;
+    std::vector<std::uint64_t> bestWords_;
+    BranchBoundStats stats_;
+    const CancelToken* cancel_ = nullptr;
+};
+
+} // namespace detail
+
+static void checkBranchBoundInput(const std::vector<flowshop::Job>& allJobs,
+                                  const std::vector<int>& outsourcingCosts,
+                                  int m, int U) {
+    checkDPInput(allJobs, outsourcingCosts, U);
+    if (m <= 0) throw std::invalid_argument("m must be positive");
+    for (const auto& job : allJobs) {
+        if (job.p <= 0 || job.w < 0) {
+            throw std::invalid_argument("solveBranchAndBound needs p > 0 and w >= 0 (lower bound)");
+        }
+    }
+}
+
+// In-house mask (by job index) of dp[n][U] in `decisions`.
+static std::vector<char> keptFromDecisions(const DPDecisionTable& decisions, int n, int U,
+                                           const std::vector<int>& outsourcingCosts,
+                                           std::vector<int>& scratch) {
+    std::vector<char> kept(n, 0);
+    decisions.collectInhouseIndices(n, U, outsourcingCosts, scratch);
+    for (int idx : scratch) kept[idx] = 1;
+    return kept;
+}
+
+// Search seeded with a feasible incumbent: the in-house mask `incumbentKept`
+// (by job index) and its objective. Returns the best set found.
+static NaiveResult branchAndBoundFrom(const std::vector<flowshop::Job>& allJobs,
+                                      const std::vector<int>& outsourcingCosts,
+                                      int m, int U,
+                                      long long incumbentObjective,
+                                      const std::vector<char>& incumbentKept,
+                                      const CancelToken* cancel,
+                                      BranchBoundStats* stats) {
+    const int n = static_cast<int>(allJobs.size());
+    std::vector<std::uint64_t> seedSet((n + 63) / 64, 0);
+    for (int x = 0; x < n; ++x) {
+        if (incumbentKept[x]) seedSet[x >> 6] |= 1ULL << (x & 63);
+    }
+
+    detail::BranchAndBound search(allJobs, outsourcingCosts, m, U);
+    search.setIncumbent(incumbentObjective, seedSet);
+    search.setCancel(cancel);
+    search.run();
+    if (stats) *stats = search.stats();
+
+    std::vector<char> kept(n, 0);
+    const auto& set = search.bestSet();
+    for (int x = 0; x < n; ++x) kept[x] = (set[x >> 6] >> (x & 63)) & 1ULL;
+    return resultFromKept(allJobs, outsourcingCosts, m, kept);
+}
+
+NaiveResult solveBranchAndBound(const std::vector<flowshop::Job>& allJobs,
+                                const std::vector<int>& outsourcingCosts,
+                                int m, int U,
+                                BranchBoundStats* stats = nullptr) {
+    checkBranchBoundInput(allJobs, outsourcingCosts, m, U);
+
+    // Incumbent: the DP's in-house set (already feasible, usually near optimal);
+    // dp[n][U] is that set's black-box objective, so no extra call is needed.
+    SolverWorkspace ws;
+    ws.beginInstance();
+    runDPRows(allJobs, outsourcingCosts, m, U, ws, nullptr);
+    const std::vector<char> kept = keptFromDecisions(ws.decisions, static_cast<int>(allJobs.size()), U,
+                                                     outsourcingCosts, ws.keepIndices);
+    return branchAndBoundFrom(allJobs, outsourcingCosts, m, U, ws.prevRow[U], kept, nullptr, stats);
+}
+
+// ---------- Incremental (online) schedule ----------
+// Jobs arrive (addJob) and leave (removeJob) one at a time. Two views are kept
+// up to date without starting over:
+//   - sequence(): every job in one black-box sequence. A new job is placed by
+//     one MCI insertion step into the current sequence (InsertionEvaluator),
+//     a removed job is simply taken out. This is the online variant: it can
+//     differ from solveWSPT_MCI on the same jobs, which inserts in WSPT order;
+//     rebuildSequence() re-solves it from scratch.
+//   - solve(): the solveDP result for the current jobs (in arrival order).
+//     All DP rows and decision bits are kept; row i only depends on jobs
+//     0..i-1, so an update at index k leaves rows 0..k valid and solve()
+//     recomputes rows k+1..n only (one row for an arrival). The black-box
+//     cache is keyed by job id and survives updates, so ids must be unique
+//     among current jobs; re-adding a removed id (possibly with a new p/w)
+//     clears the cache so no entry for the old job is reused.
+class IncrementalSchedule {
+public:
+    IncrementalSchedule(int m, int U) : m_(m), U_(U), decisions_(0, U), cache_(m) {
+        if (m <= 0) throw std::invalid_argument("m must be positive");
+        if (U < 0) throw std::invalid_argument("U must be non-negative");
+        rows_.emplace_back(static_cast<size_t>(U) + 1, 0LL);   // row 0
+    }
+
+    int m() const { return m_; }
+    int budget() const { return U_; }
+    int size() const { return static_cast<int>(jobs_.size()); }
+    const std::vector<flowshop::Job>& jobs() const { return jobs_; }
+    const std::vector<int>& outsourcingCosts() const { return costs_; }
+
+    void addJob(const flowshop::Job& job, int outsourcingCost) {
+        if (outsourcingCost < 0) throw std::invalid_argument("outsourcingCosts must be non-negative");
+        if (indexOf(job.id) >= 0) throw std::invalid_argument("IncrementalSchedule: duplicate job id");
+        if (removedIds_.count(job.id)) {
+            cache_.reset(m_);
+            removedIds_.clear();
+        }
+
+        jobs_.push_back(job);
+        costs_.push_back(outsourcingCost);
+        markDirty(size());
+
+        if (sequence_.empty()) {
+            sequence_.push_back(job);
+        } else {
+            evaluator_.reset(sequence_);
+            sequence_.insert(evaluator_.bestPosition(job, m_), job);
+        }
+    }
+
+    // False if no job has this id.
+    bool removeJob(int id) {
+        const int k = indexOf(id);
+        if (k < 0) return false;
+        jobs_.erase(jobs_.begin() + k);
+        costs_.erase(costs_.begin() + k);
+        markDirty(k + 1);
+        removedIds_.insert(id);
+
+        for (int r = 0; r < sequence_.size(); ++r) {
+            if (sequence_.id[r] == id) {
+                sequence_.erase(r);
+                break;
+            }
+        }
+        return true;
+    }
+
+    flowshop::Solution sequence() const {
+        flowshop::Solution sol;
+        sequence_.toJobs(sol.sequence);
+        sol.objective = sequence_.empty() ? 0 : flowshop::computeObjectiveClosedForm(sequence_, m_);
+        return sol;
+    }
+
+    void rebuildSequence() {
+        sequence_.clear();
+        if (jobs_.empty()) return;
+        const flowshop::Solution sol = flowshop::solveWSPT_MCI(jobs_, m_, false);
+        for (const auto& job : sol.sequence) sequence_.push_back(job);
+    }
+
+    // Rows that the next solve() recomputes (0 when up to date).
+    int dirtyRows() const { return dirtyFrom_ > size() ? 0 : size() - dirtyFrom_ + 1; }
+
+    // Same result as solveDP(jobs(), outsourcingCosts(), m, U).
+    NaiveResult solve() {
+        const int n = size();
+        if (dirtyFrom_ <= n) {
+            const flowshop::WSPTOrder order(jobs_);
+            rows_.resize(static_cast<size_t>(n) + 1);
+            decisions_.keepRows(dirtyFrom_ - 1, n);
+            keepList_.reserve(n);
+            keepIndices_.reserve(n);
+            for (int i = dirtyFrom_; i <= n; ++i) {
+                rows_[i].resize(static_cast<size_t>(U_) + 1);
+                computeDPColumns(i, 0, U_ + 1, rows_[i - 1], rows_[i], decisions_,
+                                 costs_, order, m_, keepList_, keepIndices_, &cache_, context_);
+            }
+        }
+        dirtyFrom_ = n + 1;
+        return dpResultFromDecisions(jobs_, costs_, m_, U_, decisions_, rows_[n][U_], &cache_);
+    }
+
+private:
+    int indexOf(int id) const {
+        for (int k = 0; k < size(); ++k) {
+            if (jobs_[k].id == id) return k;
+        }
+        return -1;
+    }
+
+    void markDirty(int row) { dirtyFrom_ = std::min(dirtyFrom_, row); }
+
+    int m_;
+    int U_;
+    std::vector<flowshop::Job> jobs_;
+    std::vector<int> costs_;
+
+    flowshop::JobsSoA sequence_;
+    flowshop::InsertionEvaluator evaluator_;
+
+    std::vector<std::vector<long long>> rows_;   // rows_[i] = dp[i][0..U]
+    DPDecisionTable decisions_;
+    int dirtyFrom_ = 1;                          // first row that is out of date
+    BlackBoxCache cache_;
+    std::unordered_set<int> removedIds_;         // ids that may still have cache entries
+    flowshop::SolverContext context_;
+    std::vector<flowshop::Job> keepList_;
+    std::vector<int> keepIndices_;
+};
+
+// ---------- Anytime solving under a deadline ----------
+// For callers with a latency budget: each solver polls a CancelToken between
+// chunks of work and, when it fires, returns the best feasible result found
+// so far instead of running on. `provenOptimal` is only set when an exact
+// search (naive walk or branch and bound) ran to the end; the DP on its own
+// never proves optimality.
+struct AnytimeResult {
+    NaiveResult result;
+    bool completed = false;       // the solver finished its search before the token fired
+    bool provenOptimal = false;   // result is the exact optimum (same as solveNaiveDetailed)
+};
+
+// Quick feasible start: outsource jobs by decreasing w*p per unit of u (the
+// most objective taken out per unit of budget) while they fit; free jobs
+// (u = 0) always go. One black-box call.
+// The greedy in-house mask (by job index); input already checked.
+static std::vector<char> greedyKept(const std::vector<flowshop::Job>& allJobs,
+                                    const std::vector<int>& outsourcingCosts,
+                                    int U) {
+    const int n = static_cast<int>(allJobs.size());
+    std::vector<int> byRatio(n);
+    std::iota(byRatio.begin(), byRatio.end(), 0);
+    std::stable_sort(byRatio.begin(), byRatio.end(), [&](int a, int b) {
+        // u = 0 first (in index order), then w_a p_a / u_a > w_b p_b / u_b. The
+        // cross products alone are not a strict weak order once u = 0 meets
+        // w p = 0 (both products are 0, so such a pair looks equivalent to anything).
+        const bool freeA = outsourcingCosts[a] == 0;
+        const bool freeB = outsourcingCosts[b] == 0;
+        if (freeA || freeB) return freeA && !freeB;
+        return ratioLess(wideMul(allJobs[b].w, allJobs[b].p), outsourcingCosts[b],
+                         wideMul(allJobs[a].w, allJobs[a].p), outsourcingCosts[a]);
+    });
+
+    std::vector<char> kept(n, 1);
+    long long spent = 0;
+    for (int x : byRatio) {
+        if (spent + outsourcingCosts[x] <= U) {
+            spent += outsourcingCosts[x];
+            kept[x] = 0;
+        }
+    }
+    return kept;
+}
+
+NaiveResult solveGreedyOutsourcing(const std::vector<flowshop::Job>& allJobs,
+                                   const std::vector<int>& outsourcingCosts,
+                                   int m, int U) {
+    checkDPInput(allJobs, outsourcingCosts, U);
+    return resultFromKept(allJobs, outsourcingCosts, m, greedyKept(allJobs, outsourcingCosts, U));
+}
+
+// Gray-code naive walk that polls `token` every `chunkMasks` masks, seeded with
+// the greedy result. Run to the end it returns exactly solveNaiveDetailed's result.
+AnytimeResult solveNaiveAnytime(const std::vector<flowshop::Job>& allJobs,
+                                const std::vector<int>& outsourcingCosts,
+                                int m, int U,
+                                const CancelToken& token,
+                                unsigned long long chunkMasks = 1ULL << 12) {
+    const int n = static_cast<int>(allJobs.size());
+    if (n != static_cast<int>(outsourcingCosts.size())) {
+        throw std::invalid_argument("outsourcingCosts size must match allJobs size");
+    }
+    if (n >= 63) {
+        throw std::invalid_argument("solveNaiveAnytime supports up to 62 jobs (bitmask brute force)");
+    }
+    if (chunkMasks == 0) chunkMasks = 1;
+
+    AnytimeResult out;
+    out.result = solveGreedyOutsourcing(allJobs, outsourcingCosts, m, U);
+
+    long long cost = std::accumulate(outsourcingCosts.begin(), outsourcingCosts.end(), 0LL);
+    unsigned long long mask = 0;
+    bool found = false;
+    long long bestObj = 0;
+    unsigned long long bestMask = 0;
+
+    std::vector<flowshop::Job> currentA;
+    currentA.reserve(n);
+    flowshop::SolverContext ctx;
+    const flowshop::WSPTOrder order(allJobs);
+
+    const unsigned long long totalMasks = 1ULL << n;
+    unsigned long long step = 0;
+    while (step < totalMasks && !token.cancelled()) {
+        const unsigned long long last = std::min(totalMasks, step + chunkMasks);
+        for (; step < last; ++step) {
+            if (step > 0) {
+                const int j = __builtin_ctzll(step);
+                mask ^= 1ULL << j;
+                cost += ((mask >> j) & 1ULL) ? -outsourcingCosts[j] : outsourcingCosts[j];
+            }
+            if (cost > U) continue;
+
+            order.subsetInOrder(mask, currentA);
+            const long long obj = getObjectiveOnly(order, currentA, m, nullptr, ctx);
+            if (!found || obj < bestObj || (obj == bestObj && mask < bestMask)) {
+                found = true;
+                bestObj = obj;
+                bestMask = mask;
+            }
+        }
+    }
+
+    out.completed = step == totalMasks;
+    out.provenOptimal = out.completed;
+    if (found && (out.completed || bestObj < out.result.objective)) {
+        out.result = naiveResultFromMask(allJobs, outsourcingCosts, m, found, bestObj, bestMask);
+    }
+    return out;
+}
+
+// solveDP that polls `token` every `chunkColumns` columns. If it fires in row
+// i, rows 1..i-1 are done: dp[i-1][U]'s set with jobs i-1..n-1 kept in-house
+// is still feasible and is returned when it beats the greedy start. Run to
+// the end it returns solveDP's result.
+// Also returns the in-house mask of out.result in `kept` (by job index).
+static AnytimeResult dpAnytimeWith(const std::vector<flowshop::Job>& allJobs,
+                                   const std::vector<int>& outsourcingCosts,
+                                   int m, int U,
+                                   const CancelToken& token,
+                                   int chunkColumns,
+                                   std::vector<char>& kept) {
+    const int n = static_cast<int>(allJobs.size());
+    checkDPInput(allJobs, outsourcingCosts, U);
+    chunkColumns = std::max(1, chunkColumns);
+
+    AnytimeResult out;
+    kept = greedyKept(allJobs, outsourcingCosts, U);
+    out.result = resultFromKept(allJobs, outsourcingCosts, m, kept);
+
+    SolverWorkspace ws;
+    ws.beginInstance();
+    ws.prevRow.assign(static_cast<size_t>(U) + 1, 0LL);
+    ws.curRow.resize(static_cast<size_t>(U) + 1);
+    ws.decisions.reset(n, U);
+    const flowshop::WSPTOrder order(allJobs);
+    ws.sets.reset(U, inhouseBoundApplies(order));
+
+    int rowsDone = 0;
+    bool stopped = false;
+    for (int i = 1; i <= n && !stopped; ++i) {
+        for (int c = 0; c <= U; c += chunkColumns) {
+            if (token.cancelled()) {
+                stopped = true;
+                break;
+            }
+            computeDPColumns(i, c, std::min(U + 1, c + chunkColumns), ws.prevRow, ws.curRow,
+                             ws.decisions, outsourcingCosts, order, m, ws.keepList, ws.keepIndices,
+                             nullptr, ws.context, &ws.sets);
+        }
+        if (stopped) break;
+        ws.prevRow.swap(ws.curRow);
+        ws.sets.swapRows();
+        rowsDone = i;
+    }
+
+    out.completed = rowsDone == n;
+    if (out.completed) {
+        out.result = dpResultFromDecisions(allJobs, outsourcingCosts, m, U, ws.decisions,
+                                           ws.prevRow[U], nullptr);
+        kept = keptFromDecisions(ws.decisions, n, U, outsourcingCosts, ws.keepIndices);
+        return out;
+    }
+    if (rowsDone > 0) {
+        std::vector<char> partialKept(n, 1);
+        std::fill(partialKept.begin(), partialKept.begin() + rowsDone, 0);
+        ws.decisions.collectInhouseIndices(rowsDone, U, outsourcingCosts, ws.keepIndices);
+        for (int idx : ws.keepIndices) partialKept[idx] = 1;
+        NaiveResult partial = resultFromKept(allJobs, outsourcingCosts, m, partialKept);
+        if (partial.objective < out.result.objective) {
+            out.result = std::move(partial);
+            kept = std::move(partialKept);
+        }
+    }
+    return out;
+}
+
+AnytimeResult solveDPAnytime(const std::vector<flowshop::Job>& allJobs,
+                             const std::vector<int>& outsourcingCosts,
+                             int m, int U,
+                             const CancelToken& token,
+                             int chunkColumns = 256) {
+    std::vector<char> kept;
+    return dpAnytimeWith(allJobs, outsourcingCosts, m, U, token, chunkColumns, kept);
+}
+
+// Greedy start, then the DP, then an exact search with whatever time is left:
+// branch and bound seeded with the best result so far (p > 0, w >= 0), or the
+// naive walk for other inputs with n <= 62. Always returns a feasible result.
+// `completed` covers every stage that applies: when no exact search fits the
+// input, a finished DP is a completed solve.
+AnytimeResult solveAnytime(const std::vector<flowshop::Job>& allJobs,
+                           const std::vector<int>& outsourcingCosts,
+                           int m, int U,
+                           const CancelToken& token) {
+    std::vector<char> kept;
+    AnytimeResult out = dpAnytimeWith(allJobs, outsourcingCosts, m, U, token, 256, kept);
+
+    bool boundable = true;
+    for (const auto& job : allJobs) {
+        if (job.p <= 0 || job.w < 0) boundable = false;
+    }
+    if (!out.completed || (!boundable && allJobs.size() >= 63)) return out;
+    if (token.cancelled()) {
+        out.completed = false;   // the exact stage never started
+        return out;
+    }
+
+    if (boundable) {
+        BranchBoundStats stats;
+        out.result = branchAndBoundFrom(allJobs, outsourcingCosts, m, U, out.result.objective, kept,
+                                        &token, &stats);
+        out.completed = !stats.cancelled;
+        out.provenOptimal = out.completed;
+    } else if (allJobs.size() < 63) {
+        AnytimeResult naive = solveNaiveAnytime(allJobs, outsourcingCosts, m, U, token);
+        if (naive.completed || naive.result.objective < out.result.objective) {
+            out = std::move(naive);
+        } else {
+            out.completed = false;
+        }
+    }
+    return out;
+}
+
 } // namespace flowshop_ext
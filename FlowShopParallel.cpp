@@ -0,0 +1,570 @@
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <exception>
+#include <functional>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <numeric>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+#include "FlowShopOutsource.cpp"
+
+namespace flowshop_ext {
+
+// ---------- Work-stealing thread pool ----------
+// parallelFor(count, body) runs body(worker, index) for every index in [0, count).
+// Each worker starts with a contiguous block of indices and takes them from the
+// front; a worker that runs dry steals the back half of another worker's block.
+// The calling thread acts as worker 0, so a pool of T threads starts T-1 threads.
+class WorkStealingPool {
+public:
+    explicit WorkStealingPool(int threads)
+        : threadCount_(std::max(1, threads)), ranges_(threadCount_) {
+        for (int w = 1; w < threadCount_; ++w) {
+            workers_.emplace_back([this, w]() { workerLoop(w); });
+        }
+    }
+
+    ~WorkStealingPool() {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            stop_ = true;
+        }
+        wake_.notify_all();
+        for (auto& t : workers_) t.join();
+    }
+
+    WorkStealingPool(const WorkStealingPool&) = delete;
+    WorkStealingPool& operator=(const WorkStealingPool&) = delete;
+
+    int threadCount() const { return threadCount_; }
+
+    void parallelFor(size_t count, const std::function<void(int, size_t)>& body) {
+        if (count == 0) return;
+
+        for (int w = 0; w < threadCount_; ++w) {
+            std::lock_guard<std::mutex> lock(ranges_[w].mutex);
+            ranges_[w].begin = count * w / threadCount_;
+            ranges_[w].end = count * (w + 1) / threadCount_;
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            body_ = &body;
+            error_ = nullptr;
+            failed_.store(false);
+            running_ = threadCount_ - 1;
+            ++generation_;
+        }
+        wake_.notify_all();
+
+        runTasks(0);
+
+        std::unique_lock<std::mutex> lock(mutex_);
+        done_.wait(lock, [this]() { return running_ == 0; });
+        body_ = nullptr;
+        if (error_) std::rethrow_exception(error_);
+    }
+
+private:
+    struct alignas(64) Range {
+        std::mutex mutex;
+        size_t begin = 0;
+        size_t end = 0;
+    };
+
+    bool popOwn(int w, size_t& index) {
+        Range& r = ranges_[w];
+        std::lock_guard<std::mutex> lock(r.mutex);
+        if (r.begin >= r.end) return false;
+        index = r.begin++;
+        return true;
+    }
+
+    // Move the back half of some other worker's block into w's (empty) block.
+    bool steal(int w) {
+        for (int k = 1; k < threadCount_; ++k) {
+            Range& victim = ranges_[(w + k) % threadCount_];
+            size_t begin = 0, end = 0;
+            {
+                std::lock_guard<std::mutex> lock(victim.mutex);
+                if (victim.begin >= victim.end) continue;
+                const size_t take = (victim.end - victim.begin + 1) / 2;
+                end = victim.end;
+                begin = end - take;
+                victim.end = begin;
+            }
+            std::lock_guard<std::mutex> lock(ranges_[w].mutex);
+            ranges_[w].begin = begin;
+            ranges_[w].end = end;
+            return true;
+        }
+        return false;
+    }
+
+    void runTasks(int w) {
+        size_t index = 0;
+        for (;;) {
+            if (!popOwn(w, index)) {
+                if (!steal(w)) return;
+                continue;
+            }
+            if (failed_.load(std::memory_order_relaxed)) continue;
+            try {
+                (*body_)(w, index);
+            } catch (...) {
+                std::lock_guard<std::mutex> lock(mutex_);
+                if (!error_) error_ = std::current_exception();
+                failed_.store(true);
+            }
+        }
+    }
+
+    void workerLoop(int w) {
+        unsigned long long seen = 0;
+        for (;;) {
+            {
+                std::unique_lock<std::mutex> lock(mutex_);
+                wake_.wait(lock, [&]() { return stop_ || generation_ != seen; });
+                if (stop_) return;
+                seen = generation_;
+            }
+
+            runTasks(w);
+
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (--running_ == 0) done_.notify_one();
+        }
+    }
+
+    const int threadCount_;
+    std::vector<Range> ranges_;
+    std::vector<std::thread> workers_;
+
+    std::mutex mutex_;
+    std::condition_variable wake_;
+    std::condition_variable done_;
+    const std::function<void(int, size_t)>* body_ = nullptr;
+    unsigned long long generation_ = 0;
+    int running_ = 0;
+    bool stop_ = false;
+    std::exception_ptr error_;
+    std::atomic<bool> failed_{false};
+};
+
+// ---------- Parallel naive solver ----------
+// Same search and same result as solveNaiveDetailed (GrayCode): the Gray-code
+// step range is cut into chunks of `chunkSteps` steps handed out by the pool.
+// Every worker keeps its own best (objective, mask) and in-house buffer; the
+// reduction picks the smallest objective, then the smallest mask, so the
+// answer does not depend on the thread count or on scheduling.
+struct NaiveRangeBest {
+    bool found = false;
+    long long objective = 0;
+    unsigned long long mask = 0;
+
+    void offer(long long obj, unsigned long long candidate) {
+        if (!found || obj < objective || (obj == objective && candidate < mask)) {
+            found = true;
+            objective = obj;
+            mask = candidate;
+        }
+    }
+};
+
+// Best budget-feasible mask over Gray steps [first, last).
+static NaiveRangeBest scanNaiveRange(const std::vector<flowshop::Job>& allJobs,
+                                     const std::vector<int>& outsourcingCosts,
+                                     int m, int U,
+                                     unsigned long long first, unsigned long long last,
+                                     WorkStealingPool& pool,
+                                     unsigned long long chunkSteps) {
+    const int n = static_cast<int>(allJobs.size());
+    if (chunkSteps == 0) chunkSteps = 1;
+
+    struct alignas(64) WorkerBest {
+        NaiveRangeBest best;
+        std::vector<flowshop::Job> inhouse;
+        flowshop::SolverContext context;
+    };
+    std::vector<WorkerBest> perWorker(pool.threadCount());
+    for (auto& wb : perWorker) wb.inhouse.reserve(n);
+    const flowshop::WSPTOrder order(allJobs);
+
+    const unsigned long long totalSteps = last - first;
+    const size_t chunks = static_cast<size_t>((totalSteps + chunkSteps - 1) / chunkSteps);
+
+    pool.parallelFor(chunks, [&](int worker, size_t chunk) {
+        WorkerBest& wb = perWorker[worker];
+        const unsigned long long begin = first + chunk * chunkSteps;
+        const unsigned long long end = std::min(last, begin + chunkSteps);
+
+        // Gray mask at the first step of the chunk; its cost from scratch once.
+        unsigned long long mask = begin ^ (begin >> 1);
+        long long cost = 0;
+        for (int j = 0; j < n; ++j) {
+            if (!((mask >> j) & 1ULL)) cost += outsourcingCosts[j];
+        }
+
+        for (unsigned long long step = begin; step < end; ++step) {
+            if (step > begin) {
+                const int j = __builtin_ctzll(step);
+                mask ^= 1ULL << j;
+                cost += ((mask >> j) & 1ULL) ? -outsourcingCosts[j] : outsourcingCosts[j];
+            }
+
+            if (cost > U) {
+                FLOWSHOP_COUNT(NaiveMasksSkipped, 1);
+                continue;
+            }
+
+            order.subsetInOrder(mask, wb.inhouse);
+            wb.best.offer(getObjectiveOnly(order, wb.inhouse, m, nullptr, wb.context), mask);
+        }
+    });
+
+    NaiveRangeBest best;
+    for (const auto& wb : perWorker) {
+        if (wb.best.found) best.offer(wb.best.objective, wb.best.mask);
+    }
+    return best;
+}
+
+static void checkNaiveInput(const std::vector<flowshop::Job>& allJobs,
+                            const std::vector<int>& outsourcingCosts,
+                            const char* solver) {
+    if (allJobs.size() != outsourcingCosts.size()) {
+        throw std::invalid_argument("outsourcingCosts size must match allJobs size");
+    }
+    if (allJobs.size() >= 63) {
+        throw std::invalid_argument(std::string(solver) + " supports up to 62 jobs (bitmask brute force)");
+    }
+}
+
+NaiveResult solveNaiveParallel(const std::vector<flowshop::Job>& allJobs,
+                               const std::vector<int>& outsourcingCosts,
+                               int m, int U,
+                               WorkStealingPool& pool,
+                               unsigned long long chunkSteps = 1ULL << 12) {
+    checkNaiveInput(allJobs, outsourcingCosts, "solveNaiveParallel");
+    const unsigned long long totalSteps = 1ULL << allJobs.size();
+    const NaiveRangeBest best = scanNaiveRange(allJobs, outsourcingCosts, m, U,
+                                               0, totalSteps, pool, chunkSteps);
+    return naiveResultFromMask(allJobs, outsourcingCosts, m, best.found, best.objective, best.mask);
+}
+
+// ---------- Sharded naive solver (several processes / nodes) ----------
+// Shard k of K walks the k-th of K equal slices of the Gray steps [0, 2^n) and reports its
+// best as one NaiveShardRecord; mergeNaiveShards reduces all K records with
+// the same rule as the in-process solvers (smallest objective, then smallest
+// mask), so the merged result equals solveNaiveDetailed's. Records carry a
+// fingerprint of the instance so shards of different instances cannot be mixed.
+struct NaiveShardRecord {
+    std::uint64_t fingerprint = 0;   // instanceFingerprint(...)
+    int n = 0;
+    int shard = 0;
+    int shardCount = 1;
+    bool found = false;              // some mask of the slice fits the budget
+    long long objective = 0;
+    unsigned long long mask = 0;     // in-house mask (bit j = job j kept)
+    long long cost = 0;              // outsourcing cost of that mask
+};
+
+// FNV-1a over n, m, U and every (id, p, w, u).
+std::uint64_t instanceFingerprint(const std::vector<flowshop::Job>& allJobs,
+                                  const std::vector<int>& outsourcingCosts,
+                                  int m, int U) {
+    std::uint64_t h = 0xcbf29ce484222325ULL;
+    auto mix = [&h](long long value) {
+        const auto bits = static_cast<unsigned long long>(value);
+        for (int b = 0; b < 64; b += 8) {
+            h ^= (bits >> b) & 0xFF;
+            h *= 0x100000001b3ULL;
+        }
+    };
+    mix(static_cast<long long>(allJobs.size()));
+    mix(m);
+    mix(U);
+    for (size_t i = 0; i < allJobs.size(); ++i) {
+        mix(allJobs[i].id);
+        mix(allJobs[i].p);
+        mix(allJobs[i].w);
+        mix(i < outsourcingCosts.size() ? outsourcingCosts[i] : 0);
+    }
+    return h;
+}
+
+NaiveShardRecord solveNaiveShard(const std::vector<flowshop::Job>& allJobs,
+                                 const std::vector<int>& outsourcingCosts,
+                                 int m, int U,
+                                 int shard, int shardCount,
+                                 WorkStealingPool& pool,
+                                 unsigned long long chunkSteps = 1ULL << 12) {
+    checkNaiveInput(allJobs, outsourcingCosts, "solveNaiveShard");
+    if (shardCount <= 0 || shard < 0 || shard >= shardCount) {
+        throw std::invalid_argument("shard must be in [0, shardCount)");
+    }
+
+    const int n = static_cast<int>(allJobs.size());
+    // Slices differ in size by at most one step.
+    const unsigned long long totalSteps = 1ULL << n;
+    const unsigned long long K = static_cast<unsigned long long>(shardCount);
+    const unsigned long long k = static_cast<unsigned long long>(shard);
+    const unsigned long long first = totalSteps / K * k + std::min(k, totalSteps % K);
+    const unsigned long long last = first + totalSteps / K + (k < totalSteps % K ? 1 : 0);
+
+    const NaiveRangeBest best = scanNaiveRange(allJobs, outsourcingCosts, m, U, first, last, pool, chunkSteps);
+
+    NaiveShardRecord record;
+    record.fingerprint = instanceFingerprint(allJobs, outsourcingCosts, m, U);
+    record.n = n;
+    record.shard = shard;
+    record.shardCount = shardCount;
+    record.found = best.found;
+    record.objective = best.objective;
+    record.mask = best.mask;
+    for (int j = 0; j < n; ++j) {
+        if (best.found && !((best.mask >> j) & 1ULL)) record.cost += outsourcingCosts[j];
+    }
+    return record;
+}
+
+NaiveShardRecord solveNaiveShard(const std::vector<flowshop::Job>& allJobs,
+                                 const std::vector<int>& outsourcingCosts,
+                                 int m, int U,
+                                 int shard, int shardCount) {
+    WorkStealingPool pool(1);
+    return solveNaiveShard(allJobs, outsourcingCosts, m, U, shard, shardCount, pool);
+}
+
+// One line per record:
+//   naive-shard v1 <fingerprint hex> <n> <shard> <shardCount> <found> <objective> <mask> <cost>
+void writeShardRecord(std::ostream& out, const NaiveShardRecord& r) {
+    const auto flags = out.flags();
+    out << "naive-shard v1 " << std::hex << r.fingerprint << std::dec << ' ' << r.n << ' '
+        << r.shard << ' ' << r.shardCount << ' ' << (r.found ? 1 : 0) << ' '
+        << r.objective << ' ' << r.mask << ' ' << r.cost << '\n';
+    out.flags(flags);
+}
+
+// Reads the next record; false at end of input. Blank lines are skipped,
+// anything else that is not a v1 record throws.
+bool readShardRecord(std::istream& in, NaiveShardRecord& r) {
+    std::string line;
+    while (std::getline(in, line)) {
+        if (line.find_first_not_of(" \t\r") == std::string::npos) continue;
+        std::istringstream fields(line);
+        std::string tag, version;
+        int found = 0;
+        fields >> tag >> version >> std::hex >> r.fingerprint >> std::dec
+               >> r.n >> r.shard >> r.shardCount >> found >> r.objective >> r.mask >> r.cost;
+        if (!fields || tag != "naive-shard" || version != "v1") {
+            throw std::runtime_error("malformed shard record: " + line);
+        }
+        r.found = found != 0;
+        return true;
+    }
+    return false;
+}
+
+// Needs exactly one record per shard 0..K-1 of this instance.
+NaiveResult mergeNaiveShards(const std::vector<flowshop::Job>& allJobs,
+                             const std::vector<int>& outsourcingCosts,
+                             int m, int U,
+                             const std::vector<NaiveShardRecord>& records) {
+    checkNaiveInput(allJobs, outsourcingCosts, "mergeNaiveShards");
+    if (records.empty()) throw std::invalid_argument("mergeNaiveShards: no records");
+
+    const std::uint64_t fingerprint = instanceFingerprint(allJobs, outsourcingCosts, m, U);
+    const int shardCount = records.front().shardCount;
+    std::vector<char> seen(static_cast<size_t>(std::max(shardCount, 0)), 0);
+    NaiveRangeBest best;
+    for (const auto& r : records) {
+        if (r.fingerprint != fingerprint) {
+            throw std::invalid_argument("mergeNaiveShards: record belongs to a different instance");
+        }
+        if (r.shardCount != shardCount || r.shard < 0 || r.shard >= shardCount) {
+            throw std::invalid_argument("mergeNaiveShards: inconsistent shard numbering");
+        }
+        if (seen[r.shard]) throw std::invalid_argument("mergeNaiveShards: duplicate shard");
+        seen[r.shard] = 1;
+        if (r.found) best.offer(r.objective, r.mask);
+    }
+    if (std::find(seen.begin(), seen.end(), 0) != seen.end()) {
+        throw std::invalid_argument("mergeNaiveShards: missing shard");
+    }
+
+    return naiveResultFromMask(allJobs, outsourcingCosts, m, best.found, best.objective, best.mask);
+}
+
+// ---------- Parallel DP (budget columns) ----------
+// Same recurrence and same result as solveDP. Within row i every column only
+// reads row i-1, so the columns are cut into chunks of `chunkColumns` (rounded
+// up to a multiple of 64 so no two chunks share a decision-bit word) and run
+// on the pool; parallelFor returning is the barrier between rows. Each worker
+// owns its keep-list / index buffers, its own BlackBoxCache and SolverContext.
+NaiveResult solveDPParallel(const std::vector<flowshop::Job>& allJobs,
+                            const std::vector<int>& outsourcingCosts,
+                            int m, int U,
+                            WorkStealingPool& pool,
+                            int chunkColumns = 256) {
+    const int n = static_cast<int>(allJobs.size());
+    checkDPInput(allJobs, outsourcingCosts, U);
+
+    chunkColumns = std::max(64, (chunkColumns + 63) / 64 * 64);
+    const int width = U + 1;
+    const size_t chunks = static_cast<size_t>((width + chunkColumns - 1) / chunkColumns);
+
+    struct alignas(64) WorkerScratch {
+        std::vector<flowshop::Job> keepList;
+        std::vector<int> keepIndices;
+        std::unique_ptr<BlackBoxCache> cache;
+        flowshop::SolverContext context;
+    };
+    std::vector<WorkerScratch> scratch(pool.threadCount());
+    for (auto& ws : scratch) {
+        ws.keepList.reserve(n);
+        ws.keepIndices.reserve(n);
+        ws.cache = std::make_unique<BlackBoxCache>(m);
+    }
+    const flowshop::WSPTOrder order(allJobs);
+
+    std::vector<long long> prevRow(static_cast<size_t>(width), 0LL);
+    std::vector<long long> curRow(static_cast<size_t>(width));
+    DPDecisionTable decisions(n, U);
+
+    for (int i = 1; i <= n; ++i) {
+        pool.parallelFor(chunks, [&](int worker, size_t chunk) {
+            const int cBegin = static_cast<int>(chunk) * chunkColumns;
+            const int cEnd = std::min(width, cBegin + chunkColumns);
+            WorkerScratch& ws = scratch[worker];
+            computeDPColumns(i, cBegin, cEnd, prevRow, curRow, decisions,
+                             outsourcingCosts, order, m, ws.keepList, ws.keepIndices, ws.cache.get(),
+                             ws.context);
+        });
+        prevRow.swap(curRow);
+    }
+
+    return dpResultFromDecisions(allJobs, outsourcingCosts, m, U, decisions, prevRow[U],
+                                 scratch[0].cache.get());
+}
+
+// ---------- Parallel multi-start local search ----------
+// The starts of flowshop::solveWSPT_MCI_LocalSearch spread over the pool.
+// Each start depends only on its index (and options.seed), so without a time
+// limit the result is the sequential one. With a limit, starts that begin
+// after the deadline are skipped; start 0 always runs.
+flowshop::Solution solveWSPT_MCI_LocalSearchParallel(std::vector<flowshop::Job> jobs, int m,
+                                                     const flowshop::LocalSearchOptions& options,
+                                                     WorkStealingPool& pool,
+                                                     flowshop::LocalSearchStats* stats = nullptr) {
+    if (m <= 0) throw std::invalid_argument("m must be positive");
+    if (jobs.empty()) throw std::invalid_argument("jobs list is empty");
+
+    flowshop::sortWSPT(jobs);
+    const auto deadline = flowshop::detail::localSearchDeadline(options);
+    const int starts = std::max(1, options.starts);
+    std::vector<flowshop::Solution> results(starts);
+    std::vector<flowshop::LocalSearchStats> parts(starts);
+    std::vector<char> ran(starts, 0);
+
+    pool.parallelFor(static_cast<size_t>(starts), [&](int, size_t k) {
+        if (k > 0 && flowshop::detail::LocalSearchClock::now() >= deadline) {
+            parts[k].timedOut = true;
+            return;
+        }
+        results[k] = flowshop::detail::localSearchStart(jobs, m, static_cast<int>(k), options,
+                                                        deadline, parts[k]);
+        ran[k] = 1;
+    });
+
+    flowshop::LocalSearchStats total;
+    total.initialObjective = parts[0].initialObjective;
+    int best = 0;
+    for (int k = 0; k < starts; ++k) {
+        flowshop::detail::addLocalSearchStats(total, parts[k]);
+        if (ran[k] && results[k].objective < results[best].objective) best = k;
+    }
+    if (stats) *stats = total;
+    return std::move(results[best]);
+}
+
+// ---------- Batch solving ----------
+// One outsourcing instance: jobs with their outsourcing costs ui, m machines, budget U.
+struct OutsourcingInstance {
+    std::vector<flowshop::Job> jobs;
+    std::vector<int> ui;
+    int m = 0;
+    int U = 0;
+};
+
+enum class BatchAlgorithm {
+    DP,     // solveDP
+    Naive   // solveNaiveDetailed (Gray code), n <= 62
+};
+
+// Solves many independent instances on a fixed pool. Each pool thread keeps one
+// SolverWorkspace (DP rows, decision bits, interned sets, buffers) for the
+// lifetime of the BatchSolver, so small instances pay no per-call setup beyond
+// clearing it. Results come back in input order.
+class BatchSolver {
+public:
+    explicit BatchSolver(int threads) : pool_(threads), workspaces_(pool_.threadCount()) {}
+
+    int threadCount() const { return pool_.threadCount(); }
+
+    std::vector<NaiveResult> solve(const OutsourcingInstance* instances, size_t count,
+                                   BatchAlgorithm algorithm = BatchAlgorithm::DP) {
+        std::vector<NaiveResult> results(count);
+        pool_.parallelFor(count, [&](int worker, size_t k) {
+            const OutsourcingInstance& inst = instances[k];
+            SolverWorkspace& ws = workspaces_[worker].ws;
+            results[k] = algorithm == BatchAlgorithm::DP
+                ? solveDP(inst.jobs, inst.ui, inst.m, inst.U, ws)
+                : solveNaiveDetailed(inst.jobs, inst.ui, inst.m, inst.U, ws);
+        });
+        return results;
+    }
+
+    std::vector<NaiveResult> solve(const std::vector<OutsourcingInstance>& instances,
+                                   BatchAlgorithm algorithm = BatchAlgorithm::DP) {
+        return solve(instances.data(), instances.size(), algorithm);
+    }
+
+    // Instances that are not stored as OutsourcingInstance (e.g. a mapped
+    // file): load(k, inst) fills instance k into a per-thread buffer whose
+    // vectors keep their capacity, so only one instance per thread is ever
+    // materialized. `load` is called concurrently from every pool thread.
+    template <class Load>
+    std::vector<NaiveResult> solveEach(size_t count, Load&& load,
+                                       BatchAlgorithm algorithm = BatchAlgorithm::DP) {
+        std::vector<NaiveResult> results(count);
+        pool_.parallelFor(count, [&](int worker, size_t k) {
+            PaddedWorkspace& slot = workspaces_[worker];
+            load(k, slot.instance);
+            const OutsourcingInstance& inst = slot.instance;
+            results[k] = algorithm == BatchAlgorithm::DP
+                ? solveDP(inst.jobs, inst.ui, inst.m, inst.U, slot.ws)
+                : solveNaiveDetailed(inst.jobs, inst.ui, inst.m, inst.U, slot.ws);
+        });
+        return results;
+    }
+
+private:
+    struct alignas(64) PaddedWorkspace {
+        SolverWorkspace ws;
+        OutsourcingInstance instance;   // solveEach's load buffer
+    };
+
+    WorkStealingPool pool_;
+    std::vector<PaddedWorkspace> workspaces_;
+};
+
+} // namespace flowshop_ext
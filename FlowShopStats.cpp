@@ -0,0 +1,203 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <cstdlib>
+#include <deque>
+#include <mutex>
+#include <new>
+
+#if defined(FLOWSHOP_STATS) && (defined(__unix__) || defined(__APPLE__))
+#include <sys/resource.h>
+#endif
+
+namespace flowshop {
+
+// ---------- Solve statistics ----------
+// Hot-path counters, off unless the program is built with -DFLOWSHOP_STATS.
+// When off, FLOWSHOP_COUNT(...) expands to nothing (its amount is not even
+// evaluated), no allocation hook is installed and statsSnapshot() returns
+// zeros. When on, each thread bumps its own counter block (no shared cache
+// line, no locked instruction) and statsSnapshot() adds up every block, so
+// counts from pool threads are included. Measure a solve with
+//     const SolveStats before = statsSnapshot();
+//     ... solve ...
+//     const SolveStats used = statsSince(before);
+struct SolveStats {
+    long long blackBoxCalls = 0;       // black-box runs (scan, presorted, context and tree engines)
+    long long blackBoxJobs = 0;        // jobs passed to those runs
+    long long insertionPositions = 0;  // insertion positions scored by the MCI scan
+    long long dpCells = 0;             // DP cells (or Pareto states) visited
+    long long dpCellsPruned = 0;       // DP keep branches settled without a black-box run (set already known, or bound)
+    long long naiveMasksSkipped = 0;   // naive masks rejected by the budget before a black-box call
+    long long boundPruned = 0;         // black-box calls skipped by the in-house lower bound
+    long long cacheHits = 0;           // BlackBoxCache lookups
+    long long cacheMisses = 0;
+    long long allocations = 0;         // global operator new calls (over-aligned new not counted)
+    long long bytesAllocated = 0;      // bytes requested from them
+    long long peakRssKb = 0;           // process peak resident set size so far, 0 if unavailable
+};
+
+enum class StatCounter {
+    BlackBoxCalls,
+    BlackBoxJobs,
+    InsertionPositions,
+    DPCells,
+    DPCellsPruned,
+    NaiveMasksSkipped,
+    BoundPruned,
+    CacheHits,
+    CacheMisses,
+    Count
+};
+
+#if defined(FLOWSHOP_STATS)
+
+constexpr bool statsEnabled = true;
+
+namespace detail {
+
+// One writer per block (its thread), so a relaxed load + store is enough;
+// readers only need each value to be untorn.
+struct StatsBlock {
+    std::atomic<long long> values[static_cast<int>(StatCounter::Count)] = {};
+};
+
+struct StatsRegistry {
+    std::mutex mutex;
+    std::deque<StatsBlock> blocks;   // stable addresses; blocks outlive their threads
+};
+
+inline StatsRegistry& statsRegistry() {
+    static StatsRegistry registry;
+    return registry;
+}
+
+inline StatsBlock& localStatsBlock() {
+    thread_local StatsBlock* block = []() {
+        StatsRegistry& registry = statsRegistry();
+        std::lock_guard<std::mutex> lock(registry.mutex);
+        registry.blocks.emplace_back();
+        return &registry.blocks.back();
+    }();
+    return *block;
+}
+
+inline void statsAdd(StatCounter counter, long long amount) {
+    std::atomic<long long>& v = localStatsBlock().values[static_cast<int>(counter)];
+    v.store(v.load(std::memory_order_relaxed) + amount, std::memory_order_relaxed);
+}
+
+// Operator new runs before any thread block exists, so allocations use two
+// plain shared counters instead.
+inline std::atomic<long long> allocationCount{0};
+inline std::atomic<long long> allocationBytes{0};
+
+inline long long peakRssKb() {
+#if defined(__unix__) || defined(__APPLE__)
+    rusage usage{};
+    if (getrusage(RUSAGE_SELF, &usage) != 0) return 0;
+#if defined(__APPLE__)
+    return static_cast<long long>(usage.ru_maxrss) / 1024;   // bytes on macOS
+#else
+    return static_cast<long long>(usage.ru_maxrss);          // kilobytes on Linux
+#endif
+#else
+    return 0;
+#endif
+}
+
+} // namespace detail
+
+#define FLOWSHOP_COUNT(counter, amount) \
+    ::flowshop::detail::statsAdd(::flowshop::StatCounter::counter, static_cast<long long>(amount))
+
+inline SolveStats statsSnapshot() {
+    long long sums[static_cast<int>(StatCounter::Count)] = {};
+    {
+        detail::StatsRegistry& registry = detail::statsRegistry();
+        std::lock_guard<std::mutex> lock(registry.mutex);
+        for (const auto& block : registry.blocks) {
+            for (int k = 0; k < static_cast<int>(StatCounter::Count); ++k) {
+                sums[k] += block.values[k].load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    SolveStats s;
+    s.blackBoxCalls = sums[static_cast<int>(StatCounter::BlackBoxCalls)];
+    s.blackBoxJobs = sums[static_cast<int>(StatCounter::BlackBoxJobs)];
+    s.insertionPositions = sums[static_cast<int>(StatCounter::InsertionPositions)];
+    s.dpCells = sums[static_cast<int>(StatCounter::DPCells)];
+    s.dpCellsPruned = sums[static_cast<int>(StatCounter::DPCellsPruned)];
+    s.naiveMasksSkipped = sums[static_cast<int>(StatCounter::NaiveMasksSkipped)];
+    s.boundPruned = sums[static_cast<int>(StatCounter::BoundPruned)];
+    s.cacheHits = sums[static_cast<int>(StatCounter::CacheHits)];
+    s.cacheMisses = sums[static_cast<int>(StatCounter::CacheMisses)];
+    s.allocations = detail::allocationCount.load(std::memory_order_relaxed);
+    s.bytesAllocated = detail::allocationBytes.load(std::memory_order_relaxed);
+    s.peakRssKb = detail::peakRssKb();
+    return s;
+}
+
+#else
+
+constexpr bool statsEnabled = false;
+
+#define FLOWSHOP_COUNT(counter, amount) ((void)0)
+
+inline SolveStats statsSnapshot() { return SolveStats{}; }
+
+#endif
+
+// Counters accumulated since `before`; peakRssKb is the current peak, not a difference.
+inline SolveStats statsSince(const SolveStats& before) {
+    SolveStats s = statsSnapshot();
+    s.blackBoxCalls -= before.blackBoxCalls;
+    s.blackBoxJobs -= before.blackBoxJobs;
+    s.insertionPositions -= before.insertionPositions;
+    s.dpCells -= before.dpCells;
+    s.dpCellsPruned -= before.dpCellsPruned;
+    s.naiveMasksSkipped -= before.naiveMasksSkipped;
+    s.boundPruned -= before.boundPruned;
+    s.cacheHits -= before.cacheHits;
+    s.cacheMisses -= before.cacheMisses;
+    s.allocations -= before.allocations;
+    s.bytesAllocated -= before.bytesAllocated;
+    return s;
+}
+
+} // namespace flowshop
+
+#if defined(FLOWSHOP_STATS)
+// Counting replacements for the global allocation functions (single
+// translation unit build, so they are defined exactly once). The array and
+// nothrow forms forward to these by default.
+void* operator new(std::size_t size) {
+    flowshop::detail::allocationCount.fetch_add(1, std::memory_order_relaxed);
+    flowshop::detail::allocationBytes.fetch_add(static_cast<long long>(size), std::memory_order_relaxed);
+    if (size == 0) size = 1;
+    for (;;) {
+        if (void* p = std::malloc(size)) return p;
+        std::new_handler handler = std::get_new_handler();
+        if (!handler) throw std::bad_alloc();
+        handler();
+    }
+}
+
+// Once inlined, GCC takes this free() for a mismatch with the new-expression
+// at the call site; the malloc in operator new above is its real pair.
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wmismatched-new-delete"
+#endif
+void operator delete(void* p) noexcept {
+    std::free(p);
+}
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic pop
+#endif
+
+void operator delete(void* p, std::size_t) noexcept {
+    ::operator delete(p);
+}
+#endif
@@ -1,12 +1,19 @@
+#pragma once
 #include <algorithm>
+#include <chrono>
+#include <cstddef>
 #include <cstdint>
 #include <iomanip>
 #include <iostream>
 #include <limits>
+#include <memory_resource>
 #include <numeric>
+#include <random>
 #include <stdexcept>
 #include <string>
 #include <vector>
+#include "FlowShopKernels.cpp"
+#include "FlowShopStats.cpp"
 
 namespace flowshop {
 
@@ -21,6 +28,68 @@ struct Solution {
     long long objective = 0;       // sum w_j * C_j (on last machine)
 };
 
+// ---------- Structure-of-arrays job storage ----------
+// The same jobs as a std::vector<Job>, one contiguous array per field, so the
+// p / w scans in kernels:: can load several jobs per instruction.
+// The arrays allocate from `resource` (default: new/delete), see SolverContext.
+struct JobsSoA {
+    std::pmr::vector<int> id;
+    std::pmr::vector<long long> p;
+    std::pmr::vector<long long> w;
+
+    JobsSoA() = default;
+    explicit JobsSoA(std::pmr::memory_resource* resource) : id(resource), p(resource), w(resource) {}
+    explicit JobsSoA(const std::vector<Job>& jobs) { assign(jobs); }
+
+    int size() const { return static_cast<int>(id.size()); }
+    bool empty() const { return id.empty(); }
+
+    void reserve(size_t n) {
+        id.reserve(n);
+        p.reserve(n);
+        w.reserve(n);
+    }
+
+    void clear() {
+        id.clear();
+        p.clear();
+        w.clear();
+    }
+
+    void assign(const std::vector<Job>& jobs) {
+        clear();
+        reserve(jobs.size());
+        for (const auto& job : jobs) push_back(job);
+    }
+
+    void push_back(const Job& job) {
+        id.push_back(job.id);
+        p.push_back(job.p);
+        w.push_back(job.w);
+    }
+
+    // Insert `job` so that exactly `pos` jobs precede it.
+    void insert(int pos, const Job& job) {
+        id.insert(id.begin() + pos, job.id);
+        p.insert(p.begin() + pos, job.p);
+        w.insert(w.begin() + pos, job.w);
+    }
+
+    void erase(int pos) {
+        id.erase(id.begin() + pos);
+        p.erase(p.begin() + pos);
+        w.erase(w.begin() + pos);
+    }
+
+    Job at(int r) const { return Job{id[r], p[r], w[r]}; }
+
+    void toJobs(std::vector<Job>& out) const {
+        out.clear();
+        out.reserve(id.size());
+        for (int r = 0; r < size(); ++r) out.push_back(at(r));
+    }
+};
+
 // ---------- Utility: compute C_j (last machine) using the closed-form formula ----------
 // For a given sequence (jobs indexed by position r = 1..n):
 // C_r = sum_{k=1..r} p_k + (m-1) * max{p_1..p_r}
@@ -41,30 +110,122 @@ static long long computeObjectiveClosedForm(const std::vector<Job>& seq, int m)
     return obj;
 }
 
+// Same value for a sequence stored as SoA (SIMD scan when enabled).
+static long long computeObjectiveClosedForm(const JobsSoA& seq, int m) {
+    if (m <= 0) throw std::invalid_argument("m must be positive");
+    return kernels::closedFormObjective(seq.p.data(), seq.w.data(), seq.size(), m);
+}
+
 // Optional verification: compute objective by classic DP table C[pos][machine]
 // C[i][k] = max(C[i-1][k], C[i][k-1]) + p(job_i)
 // with p(job_i) same for every machine k.
 // This should match the closed-form objective for proportional case.
-static long long computeObjectiveDP(const std::vector<Job>& seq, int m) {
-    const int n = static_cast<int>(seq.size());
-    std::vector<std::vector<long long>> C(n, std::vector<long long>(m, 0));
-
-    for (int i = 0; i < n; ++i) {
-        for (int k = 0; k < m; ++k) {
-            long long up   = (i > 0) ? C[i - 1][k] : 0LL;
-            long long left = (k > 0) ? C[i][k - 1] : 0LL;
-            C[i][k] = std::max(up, left) + seq[i].p;
-        }
-    }
+//
+// Only row i-1 is needed for row i, so the table is one machine row updated in
+// place: before the update row[k] holds C[i-1][k] and row[k-1] already holds
+// C[i][k-1]. `row` is scratch (resized to m, capacity reused).
+static long long computeObjectiveDP(const std::vector<Job>& seq, int m, std::vector<long long>& row) {
+    if (m <= 0) throw std::invalid_argument("m must be positive");
+    row.assign(static_cast<size_t>(m), 0);
 
     long long obj = 0;
-    for (int i = 0; i < n; ++i) {
-        long long C_last = C[i][m - 1];
-        obj += seq[i].w * C_last;
+    for (const Job& job : seq) {
+        row[0] += job.p;
+        for (int k = 1; k < m; ++k) {
+            row[k] = std::max(row[k], row[k - 1]) + job.p;
+        }
+        obj += job.w * row[m - 1];
     }
     return obj;
 }
 
+// ---------- Incremental insertion evaluator ----------
+// Keeps, for a partial sequence S = s_1..s_L (all arrays start at index 0 = 0):
+//   prefP[r]   = p_1 + ... + p_r
+//   prefMax[r] = max{p_1..p_r}
+//   prefW[r]   = w_1 + ... + w_r
+//   prefWM[r]  = w_1 * prefMax[1] + ... + w_r * prefMax[r]
+//
+// Inserting job x after the first `pos` jobs changes the objective by
+//   w_x * (prefP[pos] + p_x + (m-1) * max(prefMax[pos], p_x))      (x itself)
+// + p_x * (prefW[L] - prefW[pos])                                  (shifted sums)
+// + (m-1) * sum_{r=pos+1..t-1} w_r * (p_x - prefMax[r])           (raised maxima)
+// where t is the first position with prefMax[t] >= p_x. Since prefMax is
+// non-decreasing, the last term is a range sum over prefW / prefWM, so every
+// position is scored in O(1) without building a candidate sequence.
+// reset() builds the four arrays with the kernels:: scans over S's SoA fields.
+class InsertionEvaluator {
+public:
+    InsertionEvaluator() = default;
+    explicit InsertionEvaluator(std::pmr::memory_resource* resource)
+        : prefP_(resource), prefMax_(resource), prefW_(resource), prefWM_(resource), deltas_(resource) {}
+
+    void reset(const JobsSoA& seq) {
+        const int L = seq.size();
+        prefP_.resize(L + 1);
+        prefMax_.resize(L + 1);
+        prefW_.resize(L + 1);
+        prefWM_.resize(L + 1);
+
+        prefP_[0] = 0;
+        prefMax_[0] = 0;
+        prefW_[0] = 0;
+        prefWM_[0] = 0;
+        kernels::inclusiveScanSumMax(seq.p.data(), L, prefP_.data() + 1, prefMax_.data() + 1);
+        kernels::inclusiveScanSum(seq.w.data(), L, prefW_.data() + 1);
+        kernels::multiply(seq.w.data(), prefMax_.data() + 1, L, prefWM_.data() + 1);
+        kernels::inclusiveScanSum(prefWM_.data() + 1, L, prefWM_.data() + 1);
+        size_ = L;
+    }
+
+    // Objective increase when inserting `job` at index pos in [0..L].
+    long long insertionDelta(const Job& job, int pos, int m, int firstNotBelow) const {
+        const long long p = job.p;
+        const long long mm1 = static_cast<long long>(m - 1);
+
+        long long delta = job.w * (prefP_[pos] + p + mm1 * std::max(prefMax_[pos], p));
+        delta += p * (prefW_[size_] - prefW_[pos]);
+
+        const int t = firstNotBelow;
+        if (pos + 1 < t) {
+            const long long rangeW  = prefW_[t - 1] - prefW_[pos];
+            const long long rangeWM = prefWM_[t - 1] - prefWM_[pos];
+            delta += mm1 * (p * rangeW - rangeWM);
+        }
+        return delta;
+    }
+
+    // First position t in [1..L+1] with prefMax[t] >= p (L+1 if none).
+    int firstNotBelow(long long p) const {
+        const auto it = std::lower_bound(prefMax_.begin() + 1, prefMax_.end(), p);
+        return static_cast<int>(it - prefMax_.begin());
+    }
+
+    // Best insertion index in [0..L]; ties go to the LATEST (rightmost) position.
+    // Every position is scored in one sweep (kernels::bestInsertion); same
+    // result as taking insertionDelta at each position.
+    int bestPosition(const Job& job, int m, long long* bestDeltaOut = nullptr) {
+        const int t = firstNotBelow(job.p);
+
+        deltas_.resize(size_ + 1);
+        long long bestDelta = 0;
+        const int bestPos = kernels::bestInsertion(prefP_.data(), prefMax_.data(), prefW_.data(),
+                                                   prefWM_.data(), size_, job.p, job.w, m, t,
+                                                   deltas_.data(), bestDelta);
+
+        if (bestDeltaOut) *bestDeltaOut = bestDelta;
+        return bestPos;
+    }
+
+private:
+    std::pmr::vector<long long> prefP_;
+    std::pmr::vector<long long> prefMax_;
+    std::pmr::vector<long long> prefW_;
+    std::pmr::vector<long long> prefWM_;
+    std::pmr::vector<long long> deltas_;   // bestPosition's per-position scores
+    int size_ = 0;
+};
+
 // ---------- Printing helpers (Excel-like table) ----------
 static void printFinalTable(const std::vector<Job>& seq, int m, std::ostream& out) {
     out << "\n=== Final schedule details (closed-form) ===\n";
@@ -107,17 +268,10 @@ static void printFinalTable(const std::vector<Job>& seq, int m, std::ostream& ou
     }
 }
 
-// ---------- Core algorithm: WSPT-MCI ----------
-// Step 0: re-index jobs by non-increasing w/p (WSPT order).
-// Step 1: S1 = [job1]
-// Step 2: for k=2..n: insert job k into S_{k-1} at position minimizing increase in objective.
-// Tie-break: if multiple positions give the same best objective, insert LATEST (rightmost).
-static Solution solveWSPT_MCI(std::vector<Job> jobs, int m, bool verifyDP, std::ostream& dbgOut) {
-    if (m <= 0) throw std::invalid_argument("m must be positive");
-    if (jobs.empty()) throw std::invalid_argument("jobs list is empty");
-
-    // Sort by decreasing w/p. Use cross-multiplication to avoid floating errors:
-    // w1/p1 >= w2/p2  <=>  w1*p2 >= w2*p1
+// ---------- Step 0 of both engines: WSPT order ----------
+// Sort by decreasing w/p. Use cross-multiplication to avoid floating errors:
+// w1/p1 >= w2/p2  <=>  w1*p2 >= w2*p1
+static void sortWSPT(std::vector<Job>& jobs) {
     std::stable_sort(jobs.begin(), jobs.end(), [](const Job& a, const Job& b) {
         __int128 left  = (__int128)a.w * (__int128)b.p;
         __int128 right = (__int128)b.w * (__int128)a.p;
@@ -125,51 +279,796 @@ static Solution solveWSPT_MCI(std::vector<Job> jobs, int m, bool verifyDP, std::
         // Optional tie-break: smaller p first (doesn't hurt, keeps stable behavior)
         return a.p < b.p;
     });
+}
+
+// ---------- Tracing policies ----------
+// The solvers take the trace as a template parameter. NoTrace (the default)
+// is empty and its calls sit behind `if constexpr (Trace::enabled)`, so an
+// untraced solve has no stream, no virtual call and no extra argument at all.
+// A policy only needs `enabled` and insertion(job, pos, delta); it is passed
+// by value, so keep it a small handle (StreamTrace holds a pointer).
+struct NoTrace {
+    static constexpr bool enabled = false;
+    void insertion(const Job&, int, long long) const {}
+};
+
+// Logs every insertion: "Inserted J<id> at position <pos> | Delta = <delta>".
+class StreamTrace {
+public:
+    static constexpr bool enabled = true;
+    explicit StreamTrace(std::ostream& out) : out_(&out) {}
+
+    void insertion(const Job& job, int pos, long long delta) const {
+        *out_ << "Inserted " << ("J" + std::to_string(job.id + 1))
+              << " at position " << (pos + 1)
+              << " | Delta = " << delta << "\n";
+    }
+
+private:
+    std::ostream* out_;
+};
+
+// ---------- Core algorithm: WSPT-MCI ----------
+// Step 0: re-index jobs by non-increasing w/p (WSPT order).
+// Step 1: S1 = [job1]
+// Step 2: for k=2..n: insert job k into S_{k-1} at position minimizing increase in objective.
+// Tie-break: if multiple positions give the same best objective, insert LATEST (rightmost).
+//
+// solveWSPT_MCI_Presorted skips Step 0: `jobs` must already be in WSPT order
+// (e.g. a subset taken from a WSPTOrder).
 
-    std::vector<Job> S;
+// Steps 1-2 into S, using `evaluator` as scratch.
+template <class Trace>
+static void buildWSPT_MCI(const std::vector<Job>& jobs, int m, JobsSoA& S,
+                          InsertionEvaluator& evaluator, Trace trace) {
+    FLOWSHOP_COUNT(BlackBoxCalls, 1);
+    FLOWSHOP_COUNT(BlackBoxJobs, jobs.size());
+
+    S.clear();
+    S.reserve(jobs.size());
     S.push_back(jobs[0]);
 
     for (int k = 1; k < (int)jobs.size(); ++k) {
         const Job newJob = jobs[k];
 
-        long long bestObj = std::numeric_limits<long long>::max();
-        int bestPos = 0; // insertion position index in [0..S.size()]
-        
-        // Try all insertion positions
-        for (int pos = 0; pos <= (int)S.size(); ++pos) {
-            std::vector<Job> candidate = S;
-            candidate.insert(candidate.begin() + pos, newJob);
+        // Try all insertion positions (scored incrementally against S)
+        evaluator.reset(S);
+        long long bestDelta = 0;
+        const int bestPos = evaluator.bestPosition(newJob, m, &bestDelta);
+        FLOWSHOP_COUNT(InsertionPositions, S.size() + 1);
+
+        S.insert(bestPos, newJob);
+
+        if constexpr (Trace::enabled) trace.insertion(newJob, bestPos, bestDelta);
+    }
+}
+
+static void verifyWithDP(const Solution& sol, int m, std::vector<long long>& row) {
+    long long objDP = computeObjectiveDP(sol.sequence, m, row);
+    if (objDP != sol.objective) {
+        throw std::runtime_error("Verification failed: DP objective != closed-form objective");
+    }
+}
+
+static void verifyWithDP(const Solution& sol, int m) {
+    std::vector<long long> row;
+    verifyWithDP(sol, m, row);
+}
+
+// ---------- Sampled verification ----------
+// Decides per solve whether to run the DP check, for callers that want the
+// safety net without paying for it on every call: pass next() as `verifyDP`.
+//   everyKth(k)       verifies solves 1, k+1, 2k+1, ...
+//   fraction(f, seed) verifies each solve with probability f; the generator
+//                     is seeded, so the same run checks the same solves.
+// Not thread-safe: one sampler per thread.
+class VerifySampler {
+public:
+    static VerifySampler always() { return VerifySampler(1, 0, 0); }
+    static VerifySampler never() { return VerifySampler(0, 0, 0); }
+
+    static VerifySampler everyKth(long long k) {
+        if (k <= 0) throw std::invalid_argument("k must be positive");
+        return VerifySampler(k, 0, 0);
+    }
+
+    static VerifySampler fraction(double f, std::uint64_t seed = 1) {
+        if (!(f >= 0.0 && f <= 1.0)) throw std::invalid_argument("fraction must be in [0, 1]");
+        // Compare 53 random bits against f * 2^53 (f = 1 always passes).
+        const std::uint64_t threshold = static_cast<std::uint64_t>(f * 9007199254740992.0);
+        return VerifySampler(-1, threshold, seed);
+    }
+
+    bool next() {
+        bool pick;
+        if (period_ > 0) {
+            pick = seen_ % period_ == 0;
+        } else if (period_ == 0) {
+            pick = false;
+        } else {
+            pick = (nextRandom() >> 11) < threshold_;
+        }
+        ++seen_;
+        if (pick) ++checked_;
+        return pick;
+    }
+
+    long long seen() const { return seen_; }
+    long long checked() const { return checked_; }
+
+private:
+    // period_ > 0: every period_-th solve, 0: never, -1: random fraction.
+    VerifySampler(long long period, std::uint64_t threshold, std::uint64_t seed)
+        : period_(period), threshold_(threshold), state_(seed) {}
+
+    // splitmix64
+    std::uint64_t nextRandom() {
+        std::uint64_t z = (state_ += 0x9E3779B97F4A7C15ULL);
+        z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+        z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+        return z ^ (z >> 31);
+    }
+
+    long long period_;
+    std::uint64_t threshold_;
+    std::uint64_t state_;
+    long long seen_ = 0;
+    long long checked_ = 0;
+};
+
+template <class Trace = NoTrace>
+static Solution solveWSPT_MCI_Presorted(const std::vector<Job>& jobs, int m, bool verifyDP, Trace trace = Trace()) {
+    if (m <= 0) throw std::invalid_argument("m must be positive");
+    if (jobs.empty()) throw std::invalid_argument("jobs list is empty");
+
+    JobsSoA S;
+    InsertionEvaluator evaluator;
+    buildWSPT_MCI(jobs, m, S, evaluator, trace);
+
+    Solution sol;
+    S.toJobs(sol.sequence);
+    sol.objective = computeObjectiveClosedForm(S, m);
+
+    if (verifyDP) verifyWithDP(sol, m);
+
+    return sol;
+}
+
+template <class Trace = NoTrace>
+static Solution solveWSPT_MCI(std::vector<Job> jobs, int m, bool verifyDP, Trace trace = Trace()) {
+    if (m <= 0) throw std::invalid_argument("m must be positive");
+    if (jobs.empty()) throw std::invalid_argument("jobs list is empty");
+
+    sortWSPT(jobs);
+    return solveWSPT_MCI_Presorted(jobs, m, verifyDP, trace);
+}
+
+// ---------- Per-thread solver context ----------
+// Scratch for repeated black-box calls from one thread: the partial sequence
+// and the insertion tables are kept between calls (cleared, not freed), and
+// they allocate from a bump arena (std::pmr::monotonic_buffer_resource over
+// an owned initial block). Growth past the block goes to new/delete and is
+// only returned by reset(), which callers do between top-level solves.
+// objectivePresorted() does not allocate once the buffers have grown to the
+// largest set seen. Not thread-safe: one context per thread.
+class SolverContext {
+public:
+    explicit SolverContext(size_t initialBytes = 1 << 16)
+        : block_(std::max<size_t>(initialBytes, 64)),
+          arena_(block_.data(), block_.size()),
+          sequence_(&arena_),
+          evaluator_(&arena_) {}
+
+    SolverContext(const SolverContext&) = delete;
+    SolverContext& operator=(const SolverContext&) = delete;
+
+    std::pmr::memory_resource* resource() { return &arena_; }
+
+    // Drop every buffer and rewind the arena to the initial block.
+    void reset() {
+        sequence_ = JobsSoA(&arena_);
+        evaluator_ = InsertionEvaluator(&arena_);
+        arena_.release();
+    }
+
+    // Same objective as solveWSPT_MCI_Presorted(jobs, m, false).objective.
+    template <class Trace = NoTrace>
+    long long objectivePresorted(const std::vector<Job>& jobs, int m, Trace trace = Trace()) {
+        if (m <= 0) throw std::invalid_argument("m must be positive");
+        if (jobs.empty()) throw std::invalid_argument("jobs list is empty");
+        buildWSPT_MCI(jobs, m, sequence_, evaluator_, trace);
+        return computeObjectiveClosedForm(sequence_, m);
+    }
+
+    // Same result as solveWSPT_MCI_Presorted; only the returned sequence allocates.
+    template <class Trace = NoTrace>
+    Solution solvePresorted(const std::vector<Job>& jobs, int m, bool verifyDP, Trace trace = Trace()) {
+        Solution sol;
+        sol.objective = objectivePresorted(jobs, m, trace);
+        sequence_.toJobs(sol.sequence);
+        if (verifyDP) verifyWithDP(sol, m, verifyRow_);
+        return sol;
+    }
+
+private:
+    std::vector<std::byte> block_;
+    std::pmr::monotonic_buffer_resource arena_;
+    JobsSoA sequence_;
+    InsertionEvaluator evaluator_;
+    std::vector<long long> verifyRow_;   // machine row for verifyDP (heap, kept across reset)
+};
+
+// ---------- Shared WSPT order for one instance ----------
+// Every set the outsourcing solvers evaluate is a subset of one instance,
+// handed over in job index order. Ranking the whole instance once with the
+// same stable WSPT comparator and reading a subset off that ranking gives
+// exactly what sortWSPT would produce for it, without the per-call sort and
+// its 128-bit compares. This needs a strict weak ordering, i.e. all p > 0;
+// otherwise presorted() is false, subsets come back in index order and the
+// solve keeps its own sort.
+class WSPTOrder {
+public:
+    explicit WSPTOrder(const std::vector<Job>& allJobs)
+        : jobs_(allJobs), order_(allJobs.size()), rank_(allJobs.size()) {
+        presorted_ = std::all_of(allJobs.begin(), allJobs.end(), [](const Job& j) { return j.p > 0; });
+
+        std::iota(order_.begin(), order_.end(), 0);
+        if (presorted_) {
+            std::vector<Job> tagged(allJobs);
+            for (size_t i = 0; i < tagged.size(); ++i) tagged[i].id = static_cast<int>(i);
+            sortWSPT(tagged);
+            for (size_t r = 0; r < tagged.size(); ++r) order_[r] = tagged[r].id;
+        }
+        for (size_t r = 0; r < order_.size(); ++r) rank_[order_[r]] = static_cast<int>(r);
+    }
+
+    int size() const { return static_cast<int>(jobs_.size()); }
+    bool presorted() const { return presorted_; }
+    const std::vector<Job>& jobs() const { return jobs_; }
+    int indexAt(int r) const { return order_[r]; }      // job index with WSPT rank r
+    int rankOf(int index) const { return rank_[index]; }
+
+    // Jobs whose index bit is set in `mask` (n <= 64), in WSPT order.
+    void subsetInOrder(std::uint64_t mask, std::vector<Job>& out) const {
+        out.clear();
+        for (int idx : order_) {
+            if ((mask >> idx) & 1ULL) out.push_back(jobs_[idx]);
+        }
+    }
+
+    // Jobs at the given indices, in WSPT order. `indices` is used as scratch:
+    // on return it holds the sorted ranks (a plain int sort, no ratio compares).
+    void indicesInOrder(std::vector<int>& indices, std::vector<Job>& out) const {
+        for (int& v : indices) v = rank_[v];
+        std::sort(indices.begin(), indices.end());
+        out.clear();
+        for (int r : indices) out.push_back(jobs_[order_[r]]);
+    }
+
+    // Black box on a subset read off this order.
+    template <class Trace = NoTrace>
+    Solution solve(const std::vector<Job>& subsetInOrder, int m, bool verifyDP, Trace trace = Trace()) const {
+        if (presorted_) return solveWSPT_MCI_Presorted(subsetInOrder, m, verifyDP, trace);
+        return solveWSPT_MCI(subsetInOrder, m, verifyDP, trace);
+    }
+
+    // Objective only, with `ctx`'s reusable buffers (no allocation when presorted).
+    long long objective(const std::vector<Job>& subsetInOrder, int m, SolverContext& ctx) const {
+        if (presorted_) return ctx.objectivePresorted(subsetInOrder, m);
+        return solveWSPT_MCI(subsetInOrder, m, false).objective;
+    }
+
+private:
+    std::vector<Job> jobs_;
+    std::vector<int> order_;
+    std::vector<int> rank_;
+    bool presorted_ = true;
+};
+
+// Convenience overload: the subset given as an index bitmask over the order's jobs.
+template <class Trace = NoTrace>
+static Solution solveWSPT_MCI(const WSPTOrder& order, std::uint64_t mask, int m, bool verifyDP, Trace trace = Trace()) {
+    std::vector<Job> subset;
+    order.subsetInOrder(mask, subset);
+    return order.solve(subset, m, verifyDP, trace);
+}
 
-            long long obj = computeObjectiveClosedForm(candidate, m);
+// ---------- Tree engine for large job sets ----------
+// The partial sequence lives in an implicit treap (in-order = sequence order).
+// Every node keeps sumP, maxP and sumW of its subtree.
+//
+// Why a descent is enough: jobs are inserted in WSPT order, so the new job x
+// satisfies w_x * p_r <= p_x * w_r for every job r already in S. Moving the
+// insertion point one step right (past job r) changes the delta by
+//   (w_x * p_r - p_x * w_r) + (m-1) * w_x * (M_r - M_{r-1})
+// The first part is never positive, so the delta only grows where the prefix
+// maximum rises. Consequences (t = first position with prefix max >= p_x):
+//   - positions 0..t-1 are dominated by t-1 (delta is non-increasing there);
+//   - in a subtree right of t without a new prefix maximum, its last position
+//     is the best one;
+//   - any subtree's positions are at least f(last) - (m-1)*w_x*(rise of max),
+//     which prunes subtrees that cannot beat the best position to their right.
+// The search visits positions right-to-left and only accepts strict
+// improvements, which reproduces the rightmost-on-tie rule of solveWSPT_MCI.
+class InsertionTree {
+public:
+    explicit InsertionTree(size_t capacity) { nodes_.reserve(capacity); }
 
-            // Tie-break: choose the LATEST insertion (largest pos) if equal objective
-            if (obj < bestObj || (obj == bestObj && pos > bestPos)) {
-                bestObj = obj;
+    int size() const { return root_ < 0 ? 0 : nodes_[root_].size; }
+
+    // Insert `job` so that exactly `pos` jobs precede it.
+    void insertAt(int pos, const Job& job) {
+        Node node;
+        node.job = job;
+        node.prio = nextPriority();
+        node.size = 1;
+        node.sumP = job.p;
+        node.maxP = job.p;
+        node.sumW = job.w;
+        nodes_.push_back(node);
+        const int idx = static_cast<int>(nodes_.size()) - 1;
+
+        int left = -1, right = -1;
+        split(root_, pos, left, right);
+        root_ = merge(merge(left, idx), right);
+    }
+
+    // Best insertion index in [0..L] for `job`; ties go to the rightmost position.
+    int bestPosition(const Job& job, int m, long long* bestDeltaOut = nullptr) const {
+        const int L = size();
+        const int t = firstNotBelow(job.p);
+
+        Search ctx;
+        ctx.job = job;
+        ctx.mm1 = static_cast<long long>(m - 1);
+        ctx.t = t;
+        if (t <= L) {
+            search(root_, 0, 0, 0, 1, ctx);
+        }
+
+        // Candidate t-1: there max(M_{t-1}, p_x) = p_x and no later maximum is raised.
+        long long prefP = 0, prefW = 0;
+        prefixSums(t - 1, prefP, prefW);
+        const long long totalW = root_ < 0 ? 0 : nodes_[root_].sumW;
+        const long long leftDelta = ctx.score(prefP, job.p, totalW - prefW);
+        if (!ctx.found || leftDelta < ctx.best) {
+            if (bestDeltaOut) *bestDeltaOut = leftDelta;
+            return t - 1;
+        }
+        if (bestDeltaOut) *bestDeltaOut = ctx.best;
+        return ctx.bestPos;
+    }
+
+    void collect(std::vector<Job>& out) const {
+        out.clear();
+        out.reserve(size());
+        collect(root_, out);
+    }
+
+private:
+    struct Node {
+        Job job{};
+        int left = -1;
+        int right = -1;
+        std::uint32_t prio = 0;
+        int size = 0;
+        long long sumP = 0;
+        long long maxP = 0;
+        long long sumW = 0;
+    };
+
+    struct Search {
+        Job job{};
+        long long mm1 = 0;
+        int t = 0;
+        bool found = false;
+        long long best = 0;
+        int bestPos = 0;
+
+        // Insertion delta after a prefix with sum P and max M (M >= p_x), Wafter to its right.
+        long long score(long long P, long long M, long long Wafter) const {
+            return job.w * (P + job.p + mm1 * M) + job.p * Wafter;
+        }
+
+        void consider(long long value, int pos) {
+            if (!found || value < best) {
+                found = true;
+                best = value;
                 bestPos = pos;
             }
         }
+    };
+
+    std::uint32_t nextPriority() {
+        rngState_ ^= rngState_ << 13;
+        rngState_ ^= rngState_ >> 17;
+        rngState_ ^= rngState_ << 5;
+        return rngState_;
+    }
+
+    int sizeOf(int v) const { return v < 0 ? 0 : nodes_[v].size; }
+    long long sumPOf(int v) const { return v < 0 ? 0 : nodes_[v].sumP; }
+    long long maxPOf(int v) const { return v < 0 ? 0 : nodes_[v].maxP; }
+    long long sumWOf(int v) const { return v < 0 ? 0 : nodes_[v].sumW; }
+
+    void pull(int v) {
+        Node& node = nodes_[v];
+        node.size = 1 + sizeOf(node.left) + sizeOf(node.right);
+        node.sumP = node.job.p + sumPOf(node.left) + sumPOf(node.right);
+        node.maxP = std::max(node.job.p, std::max(maxPOf(node.left), maxPOf(node.right)));
+        node.sumW = node.job.w + sumWOf(node.left) + sumWOf(node.right);
+    }
+
+    // Split the first k jobs of v into `left`, the rest into `right`.
+    void split(int v, int k, int& left, int& right) {
+        if (v < 0) {
+            left = right = -1;
+            return;
+        }
+        if (sizeOf(nodes_[v].left) < k) {
+            split(nodes_[v].right, k - sizeOf(nodes_[v].left) - 1, nodes_[v].right, right);
+            left = v;
+        } else {
+            split(nodes_[v].left, k, left, nodes_[v].left);
+            right = v;
+        }
+        pull(v);
+    }
+
+    int merge(int a, int b) {
+        if (a < 0) return b;
+        if (b < 0) return a;
+        if (nodes_[a].prio > nodes_[b].prio) {
+            nodes_[a].right = merge(nodes_[a].right, b);
+            pull(a);
+            return a;
+        }
+        nodes_[b].left = merge(a, nodes_[b].left);
+        pull(b);
+        return b;
+    }
+
+    // First 1-based position whose prefix max is >= p (L+1 if none).
+    int firstNotBelow(long long p) const {
+        int v = root_;
+        int offset = 0;
+        while (v >= 0) {
+            const Node& node = nodes_[v];
+            if (maxPOf(node.left) >= p) {
+                v = node.left;
+            } else if (node.job.p >= p) {
+                return offset + sizeOf(node.left) + 1;
+            } else {
+                offset += sizeOf(node.left) + 1;
+                v = node.right;
+            }
+        }
+        return offset + 1;
+    }
+
+    // Sums of p and w over the first k jobs.
+    void prefixSums(int k, long long& sumP, long long& sumW) const {
+        sumP = 0;
+        sumW = 0;
+        int v = root_;
+        while (v >= 0 && k > 0) {
+            const Node& node = nodes_[v];
+            const int leftSize = sizeOf(node.left);
+            if (k <= leftSize) {
+                v = node.left;
+            } else {
+                sumP += sumPOf(node.left) + node.job.p;
+                sumW += sumWOf(node.left) + node.job.w;
+                k -= leftSize + 1;
+                v = node.right;
+            }
+        }
+    }
+
+    // Subtree v holds jobs first..first+size-1, preceded by a prefix (P, M)
+    // and followed by total weight Wafter. Only positions >= ctx.t are scored.
+    void search(int v, long long P, long long M, long long Wafter, int first, Search& ctx) const {
+        if (v < 0) return;
+        const Node& node = nodes_[v];
+        const int last = first + node.size - 1;
+        if (last < ctx.t) return;
+
+        if (first >= ctx.t) {
+            const long long lastM = std::max(M, node.maxP);
+            const long long lastScore = ctx.score(P + node.sumP, lastM, Wafter);
+            const long long lowM = std::max(M, ctx.job.p);
+            if (lastM == lowM) {
+                ctx.consider(lastScore, last);
+                return;
+            }
+            const long long bound = lastScore - ctx.mm1 * ctx.job.w * (lastM - lowM);
+            if (ctx.found && bound >= ctx.best) return;
+        }
+
+        const int pos = first + sizeOf(node.left);
+        const long long nodeP = P + sumPOf(node.left) + node.job.p;
+        const long long nodeM = std::max(M, std::max(maxPOf(node.left), node.job.p));
+        const long long nodeWafter = Wafter + sumWOf(node.right);
+
+        search(node.right, nodeP, nodeM, Wafter, pos + 1, ctx);
+        if (pos >= ctx.t) {
+            ctx.consider(ctx.score(nodeP, nodeM, nodeWafter), pos);
+        }
+        search(node.left, P, M, nodeWafter + node.job.w, first, ctx);
+    }
+
+    void collect(int v, std::vector<Job>& out) const {
+        if (v < 0) return;
+        collect(nodes_[v].left, out);
+        out.push_back(nodes_[v].job);
+        collect(nodes_[v].right, out);
+    }
+
+    std::vector<Node> nodes_;
+    int root_ = -1;
+    std::uint32_t rngState_ = 2463534242u;
+};
+
+// Same contract and result as solveWSPT_MCI, but each insertion is found by a
+// treap descent instead of scanning every position (near O(n log^2 n)).
+// The descent relies on WSPT order with p > 0 and w >= 0; other inputs are
+// handed to solveWSPT_MCI unchanged.
+template <class Trace = NoTrace>
+static Solution solveWSPT_MCI_Tree(std::vector<Job> jobs, int m, bool verifyDP, Trace trace = Trace()) {
+    if (m <= 0) throw std::invalid_argument("m must be positive");
+    if (jobs.empty()) throw std::invalid_argument("jobs list is empty");
+
+    for (const auto& job : jobs) {
+        if (job.p <= 0 || job.w < 0) {
+            return solveWSPT_MCI(std::move(jobs), m, verifyDP, trace);
+        }
+    }
 
-        S.insert(S.begin() + bestPos, newJob);
+    sortWSPT(jobs);
+    FLOWSHOP_COUNT(BlackBoxCalls, 1);
+    FLOWSHOP_COUNT(BlackBoxJobs, jobs.size());
 
-        // dbgOut << "Inserted " << ("J" + std::to_string(newJob.id + 1))
-        //        << " at position " << (bestPos + 1)
-        //        << " | Obj = " << bestObj << "\n";
+    InsertionTree tree(jobs.size());
+    tree.insertAt(0, jobs[0]);
+    for (int k = 1; k < (int)jobs.size(); ++k) {
+        long long bestDelta = 0;
+        const int bestPos = tree.bestPosition(jobs[k], m, Trace::enabled ? &bestDelta : nullptr);
+        tree.insertAt(bestPos, jobs[k]);
+        if constexpr (Trace::enabled) trace.insertion(jobs[k], bestPos, bestDelta);
     }
 
     Solution sol;
-    sol.sequence = std::move(S);
+    tree.collect(sol.sequence);
     sol.objective = computeObjectiveClosedForm(sol.sequence, m);
 
-    if (verifyDP) {
-        long long objDP = computeObjectiveDP(sol.sequence, m);
-        if (objDP != sol.objective) {
-            throw std::runtime_error("Verification failed: DP objective != closed-form objective");
+    if (verifyDP) verifyWithDP(sol, m);
+
+    return sol;
+}
+
+// Test mode: run both engines on the same jobs and require identical sequences.
+inline Solution crossCheckEngines(const std::vector<Job>& jobs, int m) {
+    Solution reference = solveWSPT_MCI(jobs, m, false);
+    Solution tree = solveWSPT_MCI_Tree(jobs, m, false);
+
+    bool same = reference.objective == tree.objective &&
+                reference.sequence.size() == tree.sequence.size();
+    for (size_t i = 0; same && i < reference.sequence.size(); ++i) {
+        same = reference.sequence[i].id == tree.sequence[i].id;
+    }
+    if (!same) {
+        throw std::runtime_error("Engine mismatch: solveWSPT_MCI_Tree != solveWSPT_MCI");
+    }
+    return tree;
+}
+
+// ---------- Local search after WSPT-MCI ----------
+// Optional post-optimization of a black-box sequence. The outsourcing solvers
+// never use it: their cache and bounds assume the plain WSPT-MCI objective.
+// Two neighbourhoods, both scored without recomputing the objective:
+//   adjacent swap (r, r+1): only C_r and C_{r+1} change and the prefix max
+//     after r+1 does not, so a move is O(1) from P_{r-1} and M_{r-1};
+//   remove / re-insert: with the job at r taken out, InsertionEvaluator
+//     scores all L positions in one sweep, and its score at r is what the
+//     removal saved, so a job's L moves cost O(L) together.
+// Passes (one of each) repeat until neither improves or the budget runs out.
+// A move is applied only when strictly better.
+struct LocalSearchOptions {
+    int maxPasses = 100;                              // 0 = until no move improves
+    std::chrono::steady_clock::duration timeLimit{};  // zero = no limit (shared by all starts)
+    int starts = 1;                                   // start 0 is the WSPT-MCI sequence
+    int perturbation = 0;                             // adjacent swaps of the WSPT order per extra start (0 = n/4)
+    std::uint64_t seed = 1;
+};
+
+struct LocalSearchStats {
+    long long passes = 0;
+    long long movesEvaluated = 0;
+    long long movesApplied = 0;
+    int starts = 0;                 // starts actually run
+    bool timedOut = false;
+    long long initialObjective = 0; // WSPT-MCI objective before any search
+};
+
+namespace detail {
+
+using LocalSearchClock = std::chrono::steady_clock;
+
+inline LocalSearchClock::time_point localSearchDeadline(const LocalSearchOptions& options) {
+    if (options.timeLimit <= LocalSearchClock::duration::zero()) return LocalSearchClock::time_point::max();
+    return LocalSearchClock::now() + options.timeLimit;
+}
+
+// One pass of improving adjacent swaps; returns the objective change.
+inline long long adjacentSwapPass(JobsSoA& seq, int m, std::vector<long long>& P,
+                                  std::vector<long long>& M, LocalSearchStats& stats) {
+    const int L = seq.size();
+    const long long mm1 = static_cast<long long>(m - 1);
+    P.resize(L);
+    M.resize(L);
+    kernels::inclusiveScanSumMax(seq.p.data(), L, P.data(), M.data());
+
+    long long change = 0;
+    for (int r = 0; r + 1 < L; ++r) {
+        const long long Pb = r > 0 ? P[r - 1] : 0;
+        const long long Mb = r > 0 ? M[r - 1] : 0;
+        const long long pa = seq.p[r], wa = seq.w[r];
+        const long long pb = seq.p[r + 1], wb = seq.w[r + 1];
+        const long long Mab = M[r + 1];   // max(Mb, pa, pb), the same either way
+
+        const long long before = wa * (Pb + pa + mm1 * std::max(Mb, pa)) + wb * (Pb + pa + pb + mm1 * Mab);
+        const long long after = wb * (Pb + pb + mm1 * std::max(Mb, pb)) + wa * (Pb + pa + pb + mm1 * Mab);
+        ++stats.movesEvaluated;
+        if (after < before) {
+            std::swap(seq.id[r], seq.id[r + 1]);
+            std::swap(seq.p[r], seq.p[r + 1]);
+            std::swap(seq.w[r], seq.w[r + 1]);
+            P[r] = Pb + pb;
+            M[r] = std::max(Mb, pb);
+            change += after - before;
+            ++stats.movesApplied;
         }
     }
+    return change;
+}
 
+// One pass of improving remove / re-insert moves; returns the objective change.
+inline long long reinsertionPass(JobsSoA& seq, int m, InsertionEvaluator& evaluator,
+                                 LocalSearchClock::time_point deadline, LocalSearchStats& stats) {
+    const int L = seq.size();
+    long long change = 0;
+    for (int r = 0; r < L; ++r) {
+        if (LocalSearchClock::now() >= deadline) {
+            stats.timedOut = true;
+            break;
+        }
+        const Job job = seq.at(r);
+        seq.erase(r);
+        evaluator.reset(seq);
+        const long long saved = evaluator.insertionDelta(job, r, m, evaluator.firstNotBelow(job.p));
+        long long bestDelta = 0;
+        const int bestPos = evaluator.bestPosition(job, m, &bestDelta);
+        stats.movesEvaluated += L;
+        if (bestDelta < saved) {
+            seq.insert(bestPos, job);
+            change += bestDelta - saved;
+            ++stats.movesApplied;
+        } else {
+            seq.insert(r, job);
+        }
+    }
+    return change;
+}
+
+// Local search on `seq` (objective `objective`) until a local optimum or the budget.
+inline long long improveSequence(JobsSoA& seq, int m, long long objective,
+                                 const LocalSearchOptions& options,
+                                 LocalSearchClock::time_point deadline, LocalSearchStats& stats) {
+    std::vector<long long> P, M;
+    InsertionEvaluator evaluator;
+    for (int pass = 0; options.maxPasses <= 0 || pass < options.maxPasses; ++pass) {
+        if (LocalSearchClock::now() >= deadline) {
+            stats.timedOut = true;
+            break;
+        }
+        ++stats.passes;
+        const long long change = adjacentSwapPass(seq, m, P, M, stats) +
+                                 reinsertionPass(seq, m, evaluator, deadline, stats);
+        objective += change;
+        if (change == 0) break;
+    }
+    return objective;
+}
+
+// Start k of a multi-start: k = 0 is WSPT-MCI itself, later starts run the
+// MCI insertion over the WSPT order with random adjacent swaps, then every
+// start is improved by local search. `wsptJobs` must be in WSPT order.
+inline Solution localSearchStart(const std::vector<Job>& wsptJobs, int m, int start,
+                                 const LocalSearchOptions& options,
+                                 LocalSearchClock::time_point deadline, LocalSearchStats& stats) {
+    std::vector<Job> order = wsptJobs;
+    if (start > 0 && order.size() > 1) {
+        std::mt19937_64 rng(options.seed ^ (0x9E3779B97F4A7C15ULL * static_cast<std::uint64_t>(start)));
+        const int swaps = options.perturbation > 0 ? options.perturbation
+                                                   : std::max(1, static_cast<int>(order.size()) / 4);
+        for (int k = 0; k < swaps; ++k) {
+            const size_t r = static_cast<size_t>(rng() % (order.size() - 1));
+            std::swap(order[r], order[r + 1]);
+        }
+    }
+
+    JobsSoA S;
+    InsertionEvaluator evaluator;
+    buildWSPT_MCI(order, m, S, evaluator, NoTrace());
+    const long long initial = computeObjectiveClosedForm(S, m);
+    if (start == 0) stats.initialObjective = initial;
+
+    improveSequence(S, m, initial, options, deadline, stats);
+    ++stats.starts;
+
+    Solution sol;
+    S.toJobs(sol.sequence);
+    sol.objective = computeObjectiveClosedForm(S, m);
     return sol;
 }
 
+inline void addLocalSearchStats(LocalSearchStats& total, const LocalSearchStats& part) {
+    total.passes += part.passes;
+    total.movesEvaluated += part.movesEvaluated;
+    total.movesApplied += part.movesApplied;
+    total.starts += part.starts;
+    total.timedOut = total.timedOut || part.timedOut;
+}
+
+} // namespace detail
+
+// Local search on an existing sequence (e.g. a black-box result).
+inline Solution improveSolution(const Solution& sol, int m, const LocalSearchOptions& options = {},
+                                LocalSearchStats* stats = nullptr) {
+    if (m <= 0) throw std::invalid_argument("m must be positive");
+    LocalSearchStats local;
+    local.initialObjective = sol.objective;
+    JobsSoA S(sol.sequence);
+    detail::improveSequence(S, m, computeObjectiveClosedForm(S, m), options,
+                            detail::localSearchDeadline(options), local);
+    local.starts = 1;
+
+    Solution out;
+    S.toJobs(out.sequence);
+    out.objective = computeObjectiveClosedForm(S, m);
+    if (stats) *stats = local;
+    return out;
+}
+
+// WSPT-MCI followed by local search, over options.starts starts (run one
+// after another; the best objective wins, the earliest start on ties). Starts
+// not reached before the time limit are skipped, but start 0 always runs.
+// Never worse than solveWSPT_MCI. See solveWSPT_MCI_LocalSearchParallel
+// (FlowShopParallel.cpp) for the starts spread over a pool.
+inline Solution solveWSPT_MCI_LocalSearch(std::vector<Job> jobs, int m, const LocalSearchOptions& options = {},
+                                          LocalSearchStats* stats = nullptr) {
+    if (m <= 0) throw std::invalid_argument("m must be positive");
+    if (jobs.empty()) throw std::invalid_argument("jobs list is empty");
+
+    sortWSPT(jobs);
+    const auto deadline = detail::localSearchDeadline(options);
+    LocalSearchStats total;
+    Solution best;
+    for (int start = 0; start < std::max(1, options.starts); ++start) {
+        if (start > 0 && detail::LocalSearchClock::now() >= deadline) {
+            total.timedOut = true;
+            break;
+        }
+        LocalSearchStats part;
+        Solution sol = detail::localSearchStart(jobs, m, start, options, deadline, part);
+        if (start == 0) total.initialObjective = part.initialObjective;
+        detail::addLocalSearchStats(total, part);
+        if (start == 0 || sol.objective < best.objective) best = std::move(sol);
+    }
+    if (stats) *stats = total;
+    return best;
+}
+
 // Public runner that prints everything you typically need.
 static Solution runAndPrint(std::vector<Job> jobs,
                             int m,
@@ -177,11 +1076,12 @@ static Solution runAndPrint(std::vector<Job> jobs,
                             bool printTable = true,
                             bool printDebugInsertions = true,
                             std::ostream& out = std::cout) {
-    // if (printDebugInsertions) {
-    //     out << "=== WSPT-MCI build log ===\n";
-    // }
-    Solution sol = solveWSPT_MCI(std::move(jobs), m, verifyDP,
-                                 printDebugInsertions ? out : *(new std::ostream(nullptr)));
+    if (printDebugInsertions) {
+        out << "=== WSPT-MCI build log ===\n";
+    }
+    Solution sol = printDebugInsertions
+        ? solveWSPT_MCI(std::move(jobs), m, verifyDP, StreamTrace(out))
+        : solveWSPT_MCI(std::move(jobs), m, verifyDP);
 
     // Print final order + objective
     out << "\n=== RESULT ===\n";
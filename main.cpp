@@ -1,11 +1,19 @@
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <fstream>
 #include <iostream>
+#include <memory>
 #include <vector>
 #include <random>
 #include <chrono>
 #include <numeric>
 #include <iomanip>
+#include <sstream>
 #include <stdexcept>
-#include "FlowShopOutsource.cpp"
+#include <string>
+#include <thread>
+#include "FlowShopInstanceIO.cpp"
 
 static void printJobList(const std::vector<flowshop::Job>& jobs,
                          const char* emptyText,
@@ -84,14 +92,26 @@ static void printInstanceSummary(const RandomInstance& inst) {
     }
 }
 
-static RandomInstance generateRandomInstance(std::mt19937& rng) {
+// Distributions used by generateRandomInstance (all bounds inclusive).
+// The defaults are the demo's instance mix.
+struct InstanceParams {
+    int nMin = 20, nMax = 25;
+    int mMin = 4, mMax = 8;
+    int pMin = 1, pMax = 20;
+    int wMin = 1, wMax = 10;
+    int uiMin = 10, uiMax = 60;
+    int budgetCap = 250;    // U is drawn from [cap/4, cap], capped by sum(ui)
+};
+
+static RandomInstance generateRandomInstance(std::mt19937& rng,
+                                             const InstanceParams& params = InstanceParams{}) {
     // Keep n small so that the naive 2^n enumeration is still reasonable.
     // Also keep U modest so DP doesn't explode in states.
-    std::uniform_int_distribution<int> distN(20, 25);
-    std::uniform_int_distribution<int> distM(4, 8);
-    std::uniform_int_distribution<int> distP(1, 20);
-    std::uniform_int_distribution<int> distW(1, 10);
-    std::uniform_int_distribution<int> distUi(10, 60);
+    std::uniform_int_distribution<int> distN(params.nMin, params.nMax);
+    std::uniform_int_distribution<int> distM(params.mMin, params.mMax);
+    std::uniform_int_distribution<int> distP(params.pMin, params.pMax);
+    std::uniform_int_distribution<int> distW(params.wMin, params.wMax);
+    std::uniform_int_distribution<int> distUi(params.uiMin, params.uiMax);
 
     RandomInstance inst;
     inst.n = distN(rng);
@@ -110,7 +130,7 @@ static RandomInstance generateRandomInstance(std::mt19937& rng) {
     }
 
     const int sumUi = static_cast<int>(std::accumulate(inst.ui.begin(), inst.ui.end(), 0LL));
-    const int maxU = std::min(250, sumUi);
+    const int maxU = std::min(params.budgetCap, sumUi);
     const int minU = std::min(maxU, std::max(0, maxU / 4));
     if (maxU == 0) {
         inst.U = 0;
@@ -130,11 +150,22 @@ static long long measureMicroseconds(Func&& func) {
     return std::chrono::duration_cast<std::chrono::microseconds>(end - start).count();
 }
 
+template <typename Func>
+static long long measureNanoseconds(Func&& func) {
+    const auto start = std::chrono::steady_clock::now();
+    func();
+    const auto end = std::chrono::steady_clock::now();
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count();
+}
+
 struct BenchmarkResult {
     flowshop_ext::NaiveResult naive;
     flowshop_ext::NaiveResult dp;
     long long naiveUs = 0;
     long long dpUs = 0;
+    int threads = 1;
+    flowshop_ext::SolveStats naiveStats;
+    flowshop_ext::SolveStats dpStats;
 };
 
 static bool validateSameObjective(const flowshop_ext::NaiveResult& a,
@@ -142,16 +173,35 @@ static bool validateSameObjective(const flowshop_ext::NaiveResult& a,
     return a.objective == b.objective;
 }
 
-static BenchmarkResult runAndBenchmark(const RandomInstance& inst) {
+// threads > 1 runs both solvers on a work-stealing pool of that many threads.
+static BenchmarkResult runAndBenchmark(const RandomInstance& inst, int threads = 1) {
     BenchmarkResult out;
+    out.threads = std::max(1, threads);
 
-    out.naiveUs = measureMicroseconds([&]() {
-        out.naive = flowshop_ext::solveNaiveDetailed(inst.jobs, inst.ui, inst.m, inst.U);
-    });
-
-    out.dpUs = measureMicroseconds([&]() {
-        out.dp = flowshop_ext::solveDP(inst.jobs, inst.ui, inst.m, inst.U);
-    });
+    if (out.threads > 1) {
+        flowshop_ext::WorkStealingPool pool(out.threads);
+        flowshop::SolveStats before = flowshop::statsSnapshot();
+        out.naiveUs = measureMicroseconds([&]() {
+            out.naive = flowshop_ext::solveNaiveParallel(inst.jobs, inst.ui, inst.m, inst.U, pool);
+        });
+        out.naiveStats = flowshop::statsSince(before);
+        before = flowshop::statsSnapshot();
+        out.dpUs = measureMicroseconds([&]() {
+            out.dp = flowshop_ext::solveDPParallel(inst.jobs, inst.ui, inst.m, inst.U, pool);
+        });
+        out.dpStats = flowshop::statsSince(before);
+    } else {
+        flowshop::SolveStats before = flowshop::statsSnapshot();
+        out.naiveUs = measureMicroseconds([&]() {
+            out.naive = flowshop_ext::solveNaiveDetailed(inst.jobs, inst.ui, inst.m, inst.U);
+        });
+        out.naiveStats = flowshop::statsSince(before);
+        before = flowshop::statsSnapshot();
+        out.dpUs = measureMicroseconds([&]() {
+            out.dp = flowshop_ext::solveDP(inst.jobs, inst.ui, inst.m, inst.U);
+        });
+        out.dpStats = flowshop::statsSince(before);
+    }
 
     if (!validateSameObjective(out.naive, out.dp)) {
         std::cout << "\n[ERROR] Objective mismatch!\n";
@@ -163,12 +213,27 @@ static BenchmarkResult runAndBenchmark(const RandomInstance& inst) {
     return out;
 }
 
+static void printSolveStats(const char* label, const flowshop_ext::SolveStats& s) {
+    std::cout << "\n=== SOLVE STATS (" << label << ") ===\n";
+    std::cout << "Black-box calls:     " << s.blackBoxCalls << " (" << s.blackBoxJobs << " jobs)\n";
+    std::cout << "Insertion positions: " << s.insertionPositions << "\n";
+    std::cout << "DP cells:            " << s.dpCells << " (" << s.dpCellsPruned << " without a black-box call)\n";
+    std::cout << "Masks skipped:       " << s.naiveMasksSkipped << " (over budget)\n";
+    std::cout << "Bound pruned:        " << s.boundPruned << " (black-box calls skipped)\n";
+    // solveDP answers repeated sets from its interned set table, not a
+    // BlackBoxCache, so these only count callers that pass a cache.
+    std::cout << "Cache hits/misses:   " << s.cacheHits << " / " << s.cacheMisses << " (shared caches only)\n";
+    std::cout << "Allocations:         " << s.allocations << " (" << s.bytesAllocated << " bytes)\n";
+    std::cout << "Peak RSS:            " << s.peakRssKb << " KB\n";
+}
+
 static void printBenchmarkSummary(const BenchmarkResult& r, int U) {
     const double naiveMs = r.naiveUs / 1000.0;
     const double dpMs = r.dpUs / 1000.0;
 
     std::cout << "\n=== BENCHMARK ===\n";
     std::cout << std::fixed << std::setprecision(3);
+    if (r.threads > 1) std::cout << "Threads:    " << r.threads << "\n";
     std::cout << "Naive time: " << naiveMs << " ms (" << r.naiveUs << " us)\n";
     std::cout << "DP time:    " << dpMs << " ms (" << r.dpUs << " us)\n";
 
@@ -179,12 +244,17 @@ static void printBenchmarkSummary(const BenchmarkResult& r, int U) {
 
     std::cout << "\nCorrectness: objectives match (" << r.dp.objective << ")\n";
 
+    if (flowshop::statsEnabled) {
+        printSolveStats("Naive", r.naiveStats);
+        printSolveStats("DP", r.dpStats);
+    }
+
     // Keep the same detailed result output format you already had
     printNaiveResult(r.naive, U);
     printDPResult(r.dp, U);
 }
 
-static void runRandomDemoOnce() {
+static void runRandomDemoOnce(int threads) {
     std::random_device rd;
     std::mt19937 rng(rd() ^ static_cast<unsigned int>(
         std::chrono::high_resolution_clock::now().time_since_epoch().count()));
@@ -193,13 +263,1049 @@ static void runRandomDemoOnce() {
     printInstanceSummary(inst);
 
     std::cout << "\nStarting Naive and DP comparison..." << std::endl;
-    BenchmarkResult bench = runAndBenchmark(inst);
+    BenchmarkResult bench = runAndBenchmark(inst, threads);
     printBenchmarkSummary(bench, inst.U);
 }
 
-int main() {
+// ---------- Benchmark sweep ----------
+// Grid over n, m, U (budget cap) and the p/w distributions. Every grid point
+// uses a fixed seed (base seed + point index), runs `warmup` untimed and
+// `repeats` timed iterations per solver, and reports min/median/p95/p99.
+struct SweepOptions {
+    std::vector<int> nValues{10, 14, 18};
+    std::vector<int> mValues{2, 6};
+    std::vector<int> budgetCaps{60, 250};
+    int warmup = 2;
+    int repeats = 10;
+    unsigned int seed = 1000u;
+    int threads = 1;
+    int maxNaiveN = 22;
+    int maxBranchBoundN = 60;
+    double approxEpsilon = 0.1;
+    bool json = false;
+};
+
+struct SweepDistribution {
+    const char* name;
+    int pMax;
+    int wMax;
+};
+
+struct SweepRow {
+    int point = 0;
+    int n = 0, m = 0, U = 0;
+    const char* distribution = "";
+    std::string solver;
+    int repeats = 0;
+    double minUs = 0, medianUs = 0, p95Us = 0, p99Us = 0;
+    long long objective = 0;
+};
+
+// Nearest-rank percentile of an already sorted sample.
+static double percentileUs(const std::vector<long long>& sortedNs, double q) {
+    if (sortedNs.empty()) return 0.0;
+    size_t rank = static_cast<size_t>(std::ceil(q * sortedNs.size()));
+    rank = std::min(sortedNs.size(), std::max<size_t>(rank, 1));
+    return sortedNs[rank - 1] / 1000.0;
+}
+
+template <typename Solve>
+static SweepRow timeSolver(const SweepOptions& opts, const std::string& solver, Solve&& solve) {
+    long long objective = 0;
+    for (int k = 0; k < opts.warmup; ++k) objective = solve();
+
+    std::vector<long long> samples;
+    samples.reserve(opts.repeats);
+    for (int k = 0; k < opts.repeats; ++k) {
+        samples.push_back(measureNanoseconds([&]() { objective = solve(); }));
+    }
+    std::sort(samples.begin(), samples.end());
+
+    SweepRow row;
+    row.solver = solver;
+    row.repeats = opts.repeats;
+    row.minUs = percentileUs(samples, 0.0);
+    row.medianUs = percentileUs(samples, 0.5);
+    row.p95Us = percentileUs(samples, 0.95);
+    row.p99Us = percentileUs(samples, 0.99);
+    row.objective = objective;
+    return row;
+}
+
+static void printSweepRows(const std::vector<SweepRow>& rows, bool json) {
+    std::cout << std::fixed << std::setprecision(3);
+    if (!json) {
+        std::cout << "point,n,m,U,distribution,solver,repeats,min_us,median_us,p95_us,p99_us,objective\n";
+        for (const auto& r : rows) {
+            std::cout << r.point << ',' << r.n << ',' << r.m << ',' << r.U << ','
+                      << r.distribution << ',' << r.solver << ',' << r.repeats << ','
+                      << r.minUs << ',' << r.medianUs << ',' << r.p95Us << ',' << r.p99Us << ','
+                      << r.objective << '\n';
+        }
+        return;
+    }
+
+    std::cout << "[\n";
+    for (size_t k = 0; k < rows.size(); ++k) {
+        const auto& r = rows[k];
+        std::cout << "  {\"point\": " << r.point << ", \"n\": " << r.n << ", \"m\": " << r.m
+                  << ", \"U\": " << r.U << ", \"distribution\": \"" << r.distribution
+                  << "\", \"solver\": \"" << r.solver << "\", \"repeats\": " << r.repeats
+                  << ", \"min_us\": " << r.minUs << ", \"median_us\": " << r.medianUs
+                  << ", \"p95_us\": " << r.p95Us << ", \"p99_us\": " << r.p99Us
+                  << ", \"objective\": " << r.objective << "}"
+                  << (k + 1 < rows.size() ? "," : "") << "\n";
+    }
+    std::cout << "]\n";
+}
+
+static void runBenchmarkSweep(const SweepOptions& opts) {
+    const SweepDistribution distributions[] = {
+        {"p1-20_w1-10", 20, 10},
+        {"p1-100_w1-100", 100, 100},
+    };
+
+    std::unique_ptr<flowshop_ext::WorkStealingPool> pool;
+    if (opts.threads > 1) pool = std::make_unique<flowshop_ext::WorkStealingPool>(opts.threads);
+
+    std::vector<SweepRow> rows;
+    int point = 0;
+    for (int n : opts.nValues) {
+        for (int m : opts.mValues) {
+            for (int cap : opts.budgetCaps) {
+                for (const auto& dist : distributions) {
+                    InstanceParams params;
+                    params.nMin = params.nMax = n;
+                    params.mMin = params.mMax = m;
+                    params.pMax = dist.pMax;
+                    params.wMax = dist.wMax;
+                    params.budgetCap = cap;
+
+                    std::mt19937 rng(opts.seed + static_cast<unsigned int>(point));
+                    const RandomInstance inst = generateRandomInstance(rng, params);
+
+                    std::vector<SweepRow> pointRows;
+                    if (n <= opts.maxNaiveN) {
+                        pointRows.push_back(timeSolver(opts, "naive", [&]() {
+                            return flowshop_ext::solveNaiveDetailed(inst.jobs, inst.ui, inst.m, inst.U).objective;
+                        }));
+                        pointRows.push_back(timeSolver(opts, "naive_split", [&]() {
+                            return flowshop_ext::solveNaiveDetailed(inst.jobs, inst.ui, inst.m, inst.U, nullptr,
+                                                                    flowshop_ext::NaiveEnumeration::SplitHalf).objective;
+                        }));
+                        if (pool) {
+                            pointRows.push_back(timeSolver(opts, "naive_parallel", [&]() {
+                                return flowshop_ext::solveNaiveParallel(inst.jobs, inst.ui, inst.m, inst.U, *pool).objective;
+                            }));
+                        }
+                    }
+                    if (n <= opts.maxBranchBoundN) {
+                        pointRows.push_back(timeSolver(opts, "branch_bound", [&]() {
+                            return flowshop_ext::solveBranchAndBound(inst.jobs, inst.ui, inst.m, inst.U).objective;
+                        }));
+                    }
+                    pointRows.push_back(timeSolver(opts, "dp", [&]() {
+                        return flowshop_ext::solveDP(inst.jobs, inst.ui, inst.m, inst.U).objective;
+                    }));
+                    if (pool) {
+                        pointRows.push_back(timeSolver(opts, "dp_parallel", [&]() {
+                            return flowshop_ext::solveDPParallel(inst.jobs, inst.ui, inst.m, inst.U, *pool).objective;
+                        }));
+                    }
+                    pointRows.push_back(timeSolver(opts, "dp_pareto", [&]() {
+                        return flowshop_ext::solveDPPareto(inst.jobs, inst.ui, inst.m, inst.U).objective;
+                    }));
+                    // Grid only (exactCellLimit 0): these instances are small
+                    // enough that the default would also run solveDP.
+                    pointRows.push_back(timeSolver(opts, "dp_approx", [&]() {
+                        return flowshop_ext::solveDPApprox(inst.jobs, inst.ui, inst.m, inst.U,
+                                                           opts.approxEpsilon, nullptr, 0).objective;
+                    }));
+
+                    // Black-box engines on the full job set.
+                    pointRows.push_back(timeSolver(opts, "wspt_mci", [&]() {
+                        return flowshop::solveWSPT_MCI(inst.jobs, inst.m, false).objective;
+                    }));
+                    pointRows.push_back(timeSolver(opts, "wspt_mci_tree", [&]() {
+                        return flowshop::solveWSPT_MCI_Tree(inst.jobs, inst.m, false).objective;
+                    }));
+
+                    for (auto& r : pointRows) {
+                        r.point = point;
+                        r.n = inst.n;
+                        r.m = inst.m;
+                        r.U = inst.U;
+                        r.distribution = dist.name;
+                        rows.push_back(std::move(r));
+                    }
+                    ++point;
+                }
+            }
+        }
+    }
+
+    printSweepRows(rows, opts.json);
+}
+
+static std::vector<int> parseIntList(const std::string& text) {
+    std::vector<int> values;
+    size_t start = 0;
+    while (start <= text.size()) {
+        const size_t comma = text.find(',', start);
+        const std::string item = text.substr(start, comma == std::string::npos ? std::string::npos : comma - start);
+        if (!item.empty()) values.push_back(std::stoi(item));
+        if (comma == std::string::npos) break;
+        start = comma + 1;
+    }
+    if (values.empty()) throw std::invalid_argument("empty list: " + text);
+    return values;
+}
+
+static flowshop_ext::OutsourcingInstance toOutsourcingInstance(const RandomInstance& inst) {
+    flowshop_ext::OutsourcingInstance out;
+    out.jobs = inst.jobs;
+    out.ui = inst.ui;
+    out.m = inst.m;
+    out.U = inst.U;
+    return out;
+}
+
+// Batch mode: solve `count` fixed-seed random instances with the batch API and
+// compare against calling solveDP on them one by one.
+static void runBatchDemo(int count, int threads) {
+    std::mt19937 rng(12345u);
+    std::vector<flowshop_ext::OutsourcingInstance> instances;
+    instances.reserve(count);
+    for (int k = 0; k < count; ++k) {
+        instances.push_back(toOutsourcingInstance(generateRandomInstance(rng)));
+    }
+
+    flowshop_ext::BatchSolver batch(threads);
+    std::vector<flowshop_ext::NaiveResult> results;
+    const long long batchUs = measureMicroseconds([&]() {
+        results = batch.solve(instances);
+    });
+
+    std::vector<flowshop_ext::NaiveResult> single(instances.size());
+    const long long singleUs = measureMicroseconds([&]() {
+        for (size_t k = 0; k < instances.size(); ++k) {
+            const auto& inst = instances[k];
+            single[k] = flowshop_ext::solveDP(inst.jobs, inst.ui, inst.m, inst.U);
+        }
+    });
+
+    for (size_t k = 0; k < instances.size(); ++k) {
+        if (!validateSameObjective(results[k], single[k])) {
+            throw std::runtime_error("Batch and single-call DP objectives do not match");
+        }
+    }
+
+    std::cout << "\n=== BATCH ===\n";
+    std::cout << std::fixed << std::setprecision(3);
+    std::cout << "Instances:  " << count << " (DP, " << batch.threadCount() << " threads)\n";
+    std::cout << "Batch time: " << batchUs / 1000.0 << " ms";
+    if (batchUs > 0) std::cout << " (" << count * 1e6 / batchUs << " instances/s)";
+    std::cout << "\n";
+    std::cout << "One by one: " << singleUs / 1000.0 << " ms\n";
+}
+
+// Write `count` random instances (seeded) to a binary instance file.
+static void runWriteInstances(const std::string& path, int count, unsigned int seed) {
+    std::mt19937 rng(seed);
+    flowshop_ext::InstanceFileWriter writer(path);
+    for (int k = 0; k < count; ++k) {
+        writer.write(toOutsourcingInstance(generateRandomInstance(rng)));
+    }
+    writer.close();
+    std::cout << "Wrote " << count << " instances to " << path << "\n";
+}
+
+// Solve every instance of a binary instance file: mapped and fed to the batch
+// API, then streamed and solved one by one as a cross-check.
+static void runBatchFile(const std::string& path, int threads) {
+    std::unique_ptr<flowshop_ext::MappedInstanceFile> file;
+    const long long mapUs = measureMicroseconds([&]() {
+        file = std::make_unique<flowshop_ext::MappedInstanceFile>(path);
+    });
+
+    flowshop_ext::BatchSolver batch(threads);
+    std::vector<flowshop_ext::NaiveResult> results;
+    const long long batchUs = measureMicroseconds([&]() {
+        results = flowshop_ext::solveBatch(batch, *file);
+    });
+
+    std::ifstream in(path, std::ios::binary);
+    flowshop_ext::InstanceStreamReader reader(in);
+    flowshop_ext::OutsourcingInstance inst;
+    size_t k = 0;
+    while (reader.next(inst)) {
+        const flowshop_ext::NaiveResult single = flowshop_ext::solveDP(inst.jobs, inst.ui, inst.m, inst.U);
+        if (k >= results.size() || !validateSameObjective(results[k], single)) {
+            throw std::runtime_error("Mapped batch and streamed DP objectives do not match");
+        }
+        ++k;
+    }
+
+    std::cout << "\n=== BATCH FILE ===\n";
+    std::cout << std::fixed << std::setprecision(3);
+    std::cout << "Instances:  " << file->size() << " (DP, " << batch.threadCount() << " threads)\n";
+    std::cout << "Map+index:  " << mapUs / 1000.0 << " ms\n";
+    std::cout << "Batch time: " << batchUs / 1000.0 << " ms";
+    if (batchUs > 0) std::cout << " (" << file->size() * 1e6 / batchUs << " instances/s)";
+    std::cout << "\n";
+}
+
+// Both engines again with StreamTrace into a string: one log line per
+// insertion (every job after the first), the same log from both engines,
+// and the same result as the untraced (NoTrace) solve.
+static void checkTracedEngines(const std::vector<flowshop::Job>& jobs, int m,
+                               const flowshop::Solution& untraced) {
+    auto fail = [](const std::string& what) {
+        throw std::runtime_error("Engine check failed: " + what);
+    };
+    auto sameSolution = [](const flowshop::Solution& a, const flowshop::Solution& b) {
+        if (a.objective != b.objective || a.sequence.size() != b.sequence.size()) return false;
+        for (size_t i = 0; i < a.sequence.size(); ++i) {
+            if (a.sequence[i].id != b.sequence[i].id) return false;
+        }
+        return true;
+    };
+
+    std::ostringstream mciLog, treeLog;
+    const flowshop::Solution mci = flowshop::solveWSPT_MCI(jobs, m, false, flowshop::StreamTrace(mciLog));
+    const flowshop::Solution tree = flowshop::solveWSPT_MCI_Tree(jobs, m, false, flowshop::StreamTrace(treeLog));
+    if (!sameSolution(mci, untraced) || !sameSolution(tree, untraced)) {
+        fail("a traced solve differs from the NoTrace solve");
+    }
+    const std::string log = mciLog.str();
+    if (static_cast<size_t>(std::count(log.begin(), log.end(), '\n')) != jobs.size() - 1) {
+        fail("StreamTrace did not log one line per insertion");
+    }
+    if (jobs.size() > 1 && log.rfind("Inserted ", 0) != 0) fail("StreamTrace line format changed");
+    if (treeLog.str() != log) fail("solveWSPT_MCI_Tree and solveWSPT_MCI log different insertions");
+}
+
+// Test mode: compare the tree engine against solveWSPT_MCI on fixed-seed job sets,
+// from tiny sets full of ratio ties up to a few thousand jobs, untraced and
+// with a StreamTrace build log.
+static void runEngineCheck() {
+    std::mt19937 rng(20240601u);
+    std::uniform_int_distribution<int> distM(1, 8);
+
+    const int sizes[] = {1, 2, 3, 5, 8, 13, 25, 60, 150, 400, 1000, 3000};
+    const int ranges[] = {3, 20, 1000000};
+    int checked = 0;
+
+    for (int n : sizes) {
+        for (int range : ranges) {
+            const int repeats = n <= 150 ? 50 : 3;
+            std::uniform_int_distribution<int> distPW(1, range);
+            for (int rep = 0; rep < repeats; ++rep) {
+                std::vector<flowshop::Job> jobs;
+                jobs.reserve(n);
+                for (int i = 0; i < n; ++i) {
+                    jobs.push_back(flowshop::Job{i, distPW(rng), distPW(rng)});
+                }
+                const int m = distM(rng);
+                const flowshop::Solution untraced = flowshop::crossCheckEngines(jobs, m);
+                checkTracedEngines(jobs, m, untraced);
+                ++checked;
+            }
+        }
+    }
+
+    std::cout << "Engine check: " << checked
+              << " job sets, solveWSPT_MCI_Tree matches solveWSPT_MCI; with StreamTrace both log one "
+                 "identical line per insertion and return the NoTrace result\n";
+}
+
+// Test mode: random add / remove / re-add sequences on an IncrementalSchedule,
+// re-adding removed ids with new p and w, checked against solveDP after every
+// step; the online sequence is checked too, and rebuilt every fifth step.
+static void runIncrementalCheck() {
+    std::mt19937 rng(20240602u);
+    std::uniform_int_distribution<int> distM(1, 5);
+    std::uniform_int_distribution<int> distPW(1, 20);
+    std::uniform_int_distribution<int> distU(0, 10);
+    std::uniform_int_distribution<int> distId(0, 11);
+    std::uniform_int_distribution<int> distAction(0, 2);
+    int steps = 0;
+
+    for (int rep = 0; rep < 300; ++rep) {
+        const int m = distM(rng);
+        const int U = distU(rng) * 3;
+        flowshop_ext::IncrementalSchedule schedule(m, U);
+
+        for (int step = 0; step < 25; ++step) {
+            const int id = distId(rng);
+            const bool present = std::any_of(schedule.jobs().begin(), schedule.jobs().end(),
+                                             [id](const flowshop::Job& job) { return job.id == id; });
+            if (present && distAction(rng) == 0) {
+                schedule.removeJob(id);
+            } else if (!present) {
+                schedule.addJob(flowshop::Job{id, distPW(rng), distPW(rng)}, distU(rng));
+            }
+
+            const flowshop_ext::NaiveResult incremental = schedule.solve();
+            const flowshop_ext::NaiveResult direct =
+                flowshop_ext::solveDP(schedule.jobs(), schedule.outsourcingCosts(), m, U);
+            if (incremental.objective != direct.objective) {
+                throw std::runtime_error("Incremental check failed: IncrementalSchedule::solve() "
+                                         "differs from solveDP");
+            }
+
+            // The online sequence holds exactly the current jobs and reports
+            // their closed-form objective; every fifth step it is rebuilt and
+            // must then be the WSPT-MCI sequence.
+            const flowshop::Solution online = schedule.sequence();
+            auto byId = [](const flowshop::Job& a, const flowshop::Job& b) { return a.id < b.id; };
+            std::vector<flowshop::Job> inSequence = online.sequence;
+            std::vector<flowshop::Job> current = schedule.jobs();
+            std::sort(inSequence.begin(), inSequence.end(), byId);
+            std::sort(current.begin(), current.end(), byId);
+            const bool permutation = std::equal(inSequence.begin(), inSequence.end(), current.begin(), current.end(),
+                [](const flowshop::Job& a, const flowshop::Job& b) {
+                    return a.id == b.id && a.p == b.p && a.w == b.w;
+                });
+            if (!permutation) {
+                throw std::runtime_error("Incremental check failed: sequence() is not a permutation of jobs()");
+            }
+            if (online.objective != flowshop::computeObjectiveClosedForm(online.sequence, m)) {
+                throw std::runtime_error("Incremental check failed: sequence() objective is not its sequence's");
+            }
+            if (step % 5 == 4) {
+                schedule.rebuildSequence();
+                const long long rebuilt = schedule.sequence().objective;
+                const long long mci = schedule.jobs().empty()
+                    ? 0 : flowshop::solveWSPT_MCI(schedule.jobs(), m, false).objective;
+                if (rebuilt != mci) {
+                    throw std::runtime_error("Incremental check failed: rebuildSequence() differs from solveWSPT_MCI");
+                }
+            }
+            ++steps;
+        }
+    }
+
+    std::cout << "Incremental check: " << steps
+              << " updates, IncrementalSchedule::solve() matches solveDP, sequence() is a permutation of "
+                 "jobs() with its own objective, rebuildSequence() matches solveWSPT_MCI\n";
+}
+
+// Test mode: VerifySampler picks the solves its period or fraction asks for,
+// and every picked solveWSPT_MCI call passes its DP verification.
+static void runVerifySamplerCheck() {
+    std::mt19937 rng(20240603u);
+    std::uniform_int_distribution<int> distN(1, 40);
+    std::uniform_int_distribution<int> distM(1, 6);
+    std::uniform_int_distribution<int> distPW(1, 100);
+    auto solveWith = [&](flowshop::VerifySampler& sampler, long long solves) {
+        std::vector<long long> picked;
+        for (long long k = 0; k < solves; ++k) {
+            std::vector<flowshop::Job> jobs(distN(rng));
+            for (int i = 0; i < static_cast<int>(jobs.size()); ++i) {
+                jobs[i] = flowshop::Job{i, distPW(rng), distPW(rng)};
+            }
+            const long long before = sampler.checked();
+            flowshop::solveWSPT_MCI(jobs, distM(rng), sampler.next());
+            if (sampler.checked() != before) picked.push_back(k);
+        }
+        return picked;
+    };
+    auto fail = [](const std::string& what) {
+        throw std::runtime_error("Verify sampler check failed: " + what);
+    };
+
+    const long long solves = 20000;
+    flowshop::VerifySampler always = flowshop::VerifySampler::always();
+    if (solveWith(always, solves).size() != static_cast<size_t>(solves)) fail("always() skipped a solve");
+    flowshop::VerifySampler never = flowshop::VerifySampler::never();
+    if (!solveWith(never, solves).empty()) fail("never() verified a solve");
+
+    for (long long period : {1LL, 2LL, 7LL, 100LL}) {
+        flowshop::VerifySampler sampler = flowshop::VerifySampler::everyKth(period);
+        const std::vector<long long> picked = solveWith(sampler, solves);
+        if (static_cast<long long>(picked.size()) != (solves + period - 1) / period) {
+            fail("everyKth(" + std::to_string(period) + ") checked the wrong number of solves");
+        }
+        for (size_t k = 0; k < picked.size(); ++k) {
+            if (picked[k] != static_cast<long long>(k) * period) {
+                fail("everyKth(" + std::to_string(period) + ") picked solve " + std::to_string(picked[k] + 1));
+            }
+        }
+    }
+
+    for (double f : {0.0, 0.01, 0.25, 0.5, 1.0}) {
+        flowshop::VerifySampler a = flowshop::VerifySampler::fraction(f, 7);
+        flowshop::VerifySampler b = flowshop::VerifySampler::fraction(f, 7);
+        const std::vector<long long> picked = solveWith(a, solves);
+        if (solveWith(b, solves) != picked) fail("fraction() is not reproducible for a fixed seed");
+        // Binomial standard deviation is at most 0.0036 here; allow 5 of them.
+        const double rate = static_cast<double>(picked.size()) / static_cast<double>(solves);
+        if (std::abs(rate - f) > 0.018) {
+            fail("fraction(" + std::to_string(f) + ") verified " + std::to_string(rate) + " of the solves");
+        }
+    }
+
+    std::cout << "Verify sampler check: always, never, everyKth and fraction pick the requested solves "
+                 "(verified solves match the DP)\n";
+}
+
+// In-house mask of a result whose job ids are their indices.
+static unsigned long long inhouseMask(const flowshop_ext::NaiveResult& result, int n) {
+    unsigned long long mask = n == 0 ? 0ULL : ~0ULL >> (64 - n);
+    for (const auto& job : result.outsourced) mask &= ~(1ULL << job.id);
+    return mask;
+}
+
+// Test mode: exact solvers against the Ascending naive reference on fixed-seed
+// small instances (ids 0..n-1), full of ratio ties, u = 0 and w = 0 jobs, at a
+// random and at tight budgets, plus the parallel and sharded naive walks. The
+// objective and the in-house mask must both match (ties go to the smallest mask).
+// The DP budget curve is checked against solveDP at every budget up to the
+// random one. The reduced solvers only promise the naive objective and a
+// feasible set.
+static void runExactCheck() {
+    std::mt19937 rng(20240604u);
+    std::uniform_int_distribution<int> distN(0, 12);
+    std::uniform_int_distribution<int> distM(1, 5);
+    std::uniform_int_distribution<int> distRange(0, 2);
+    std::uniform_int_distribution<int> distU(0, 8);
+    const int ranges[] = {2, 5, 50};
+    const unsigned long long chunkSizes[] = {1, 3, 64, 1ULL << 12};
+    flowshop_ext::WorkStealingPool pool(4);
+    flowshop_ext::WorkStealingPool shardPool(1);   // one process per shard
+    int checked = 0;
+    int shardMerges = 0;
+    int curveBudgets = 0;
+    int paretoBetter = 0, paretoWorse = 0;
+
+    auto fail = [](const std::string& what, int instance) {
+        throw std::runtime_error("Exact check failed on instance " + std::to_string(instance) + ": " + what);
+    };
+    auto sameRecord = [](const flowshop_ext::NaiveShardRecord& a, const flowshop_ext::NaiveShardRecord& b) {
+        return a.fingerprint == b.fingerprint && a.n == b.n && a.shard == b.shard
+            && a.shardCount == b.shardCount && a.found == b.found && a.objective == b.objective
+            && a.mask == b.mask && a.cost == b.cost;
+    };
+    auto expectSame = [&](const flowshop_ext::NaiveResult& got, const flowshop_ext::NaiveResult& ref,
+                          int n, const std::string& name) {
+        if (got.objective != ref.objective) fail(name + " objective differs from Ascending", checked);
+        if (inhouseMask(got, n) != inhouseMask(ref, n)) fail(name + " in-house mask differs from Ascending", checked);
+    };
+
+    for (int rep = 0; rep < 3000; ++rep) {
+        const int n = distN(rng);
+        const int m = distM(rng);
+        const int range = ranges[distRange(rng)];
+        std::uniform_int_distribution<int> distP(1, range);
+        std::uniform_int_distribution<int> distW(0, range);
+        std::vector<flowshop::Job> jobs;
+        std::vector<int> ui;
+        for (int i = 0; i < n; ++i) {
+            jobs.push_back(flowshop::Job{i, distP(rng), distW(rng)});
+            ui.push_back(distU(rng));
+        }
+        const int total = std::accumulate(ui.begin(), ui.end(), 0);
+
+        // A random budget, plus tight ones: exactly the cost of a random
+        // outsourced set, one below it, and zero. SplitHalf pairs halves by
+        // binary search on the cost, so budgets that a pair meets exactly
+        // (or misses by one) are the ones that can break it.
+        int subsetCost = 0;
+        for (int u : ui) {
+            if (rng() & 1u) subsetCost += u;
+        }
+        const int budgets[] = {std::uniform_int_distribution<int>(0, total)(rng), subsetCost,
+                               std::max(0, subsetCost - 1), 0};
+        for (int U : budgets) {
+            const flowshop_ext::NaiveResult ref = flowshop_ext::solveNaiveDetailed(
+                jobs, ui, m, U, nullptr, flowshop_ext::NaiveEnumeration::Ascending);
+            expectSame(flowshop_ext::solveNaiveDetailed(jobs, ui, m, U, nullptr,
+                                                        flowshop_ext::NaiveEnumeration::GrayCode),
+                       ref, n, "GrayCode naive");
+            expectSame(flowshop_ext::solveNaiveDetailed(jobs, ui, m, U, nullptr,
+                                                        flowshop_ext::NaiveEnumeration::SplitHalf),
+                       ref, n, "SplitHalf naive");
+            expectSame(flowshop_ext::solveBranchAndBound(jobs, ui, m, U), ref, n, "solveBranchAndBound");
+
+            // The Pareto DP is feasible and consistent, but it drops states
+            // solveDP keeps, so against solveDP it is only compared.
+            const flowshop_ext::NaiveResult pareto = flowshop_ext::solveDPPareto(jobs, ui, m, U);
+            if (pareto.outsourcingCost > U) fail("solveDPPareto goes over budget", checked);
+            if (pareto.inhouseOrder.size() + pareto.outsourced.size() != jobs.size() ||
+                pareto.objective != flowshop::computeObjectiveClosedForm(pareto.inhouseOrder, m)) {
+                fail("solveDPPareto objective is not its in-house order's", checked);
+            }
+            if (pareto.objective < ref.objective) fail("solveDPPareto beats the naive optimum", checked);
+            const long long dpObjective = flowshop_ext::solveDP(jobs, ui, m, U).objective;
+            if (pareto.objective < dpObjective) ++paretoBetter;
+            if (pareto.objective > dpObjective) ++paretoWorse;
+            ++checked;
+        }
+
+        // The parallel and sharded walks at the random budget. Shards run
+        // K = 1 up to past 2^n Gray steps (so the last shards are empty) on
+        // instances small enough for that many records. Every record goes
+        // through writeShardRecord / readShardRecord, is compared field by
+        // field, and the read-back records are merged in reverse order.
+        const int U = budgets[0];
+        const flowshop_ext::NaiveResult ref = flowshop_ext::solveNaiveDetailed(jobs, ui, m, U);
+        for (unsigned long long chunk : chunkSizes) {
+            expectSame(flowshop_ext::solveNaiveParallel(jobs, ui, m, U, pool, chunk), ref, n,
+                       "solveNaiveParallel (chunk " + std::to_string(chunk) + ")");
+        }
+        // A token that never fires: the anytime solver runs every stage, so
+        // it reports a completed, proven optimum.
+        const flowshop_ext::AnytimeResult anytime =
+            flowshop_ext::solveAnytime(jobs, ui, m, U, flowshop_ext::CancelToken{});
+        if (!anytime.completed || !anytime.provenOptimal) fail("solveAnytime did not complete", checked);
+        if (anytime.result.objective != ref.objective) fail("solveAnytime objective differs from naive", checked);
+        // Budget curve up to the random budget: dpObjectiveAt(c) is solveDP at
+        // budget c, objectiveAt never rises, and resultAt(c) fits budget c.
+        const flowshop_ext::DPBudgetCurve curve = flowshop_ext::solveDPCurve(jobs, ui, m, U);
+        for (int c = 0; c <= U; ++c) {
+            if (curve.dpObjectiveAt(c) != flowshop_ext::solveDP(jobs, ui, m, c).objective) {
+                fail("DPBudgetCurve::dpObjectiveAt(" + std::to_string(c) + ") differs from solveDP", checked);
+            }
+            if (c > 0 && curve.objectiveAt(c) > curve.objectiveAt(c - 1)) {
+                fail("DPBudgetCurve::objectiveAt rises at budget " + std::to_string(c), checked);
+            }
+            const flowshop_ext::NaiveResult atC = curve.resultAt(c);
+            if (atC.outsourcingCost > c || atC.objective != curve.objectiveAt(c)) {
+                fail("DPBudgetCurve::resultAt(" + std::to_string(c) + ") is over budget or off the curve", checked);
+            }
+            ++curveBudgets;
+        }
+
+        // Tokens that have fired before the call: an expired deadline and a
+        // pre-set flag. Every anytime solver must return a feasible result
+        // that is neither completed nor proven, whose objective is its own
+        // in-house order's (n >= 1: with no jobs the DP has nothing to cut).
+        if (n > 0) {
+            const std::atomic<bool> stop{true};
+            const flowshop_ext::CancelToken fired[] = {
+                flowshop_ext::CancelToken(flowshop_ext::CancelToken::Clock::now() - std::chrono::seconds(1)),
+                flowshop_ext::CancelToken(&stop)};
+            for (const auto& token : fired) {
+                const flowshop_ext::AnytimeResult cut[] = {
+                    flowshop_ext::solveAnytime(jobs, ui, m, U, token),
+                    flowshop_ext::solveDPAnytime(jobs, ui, m, U, token),
+                    flowshop_ext::solveNaiveAnytime(jobs, ui, m, U, token)};
+                for (const auto& r : cut) {
+                    if (r.completed || r.provenOptimal) fail("an anytime solver completed with a fired token", checked);
+                    if (r.result.outsourcingCost > U) fail("a cut-short anytime result goes over budget", checked);
+                    if (r.result.inhouseOrder.size() + r.result.outsourced.size() != jobs.size() ||
+                        r.result.objective != flowshop::computeObjectiveClosedForm(r.result.inhouseOrder, m)) {
+                        fail("a cut-short anytime objective is not its in-house order's", checked);
+                    }
+                }
+            }
+        }
+
+        const int steps = 1 << n;
+        const int shardCounts[] = {1, 2, 3, 5, 8, steps - 1, steps, steps + 1, steps + 7};
+        for (int K : shardCounts) {
+            if (K < 1 || (K > 8 && n > 8)) continue;
+            std::vector<flowshop_ext::NaiveShardRecord> records;
+            for (int k = 0; k < K; ++k) {
+                const flowshop_ext::NaiveShardRecord written =
+                    flowshop_ext::solveNaiveShard(jobs, ui, m, U, k, K, shardPool);
+                std::stringstream text;
+                flowshop_ext::writeShardRecord(text, written);
+                flowshop_ext::NaiveShardRecord read;
+                if (!flowshop_ext::readShardRecord(text, read) || !sameRecord(read, written)) {
+                    fail("shard record " + std::to_string(k) + "/" + std::to_string(K)
+                             + " does not survive a write/read round trip", checked);
+                }
+                records.push_back(read);
+            }
+            std::reverse(records.begin(), records.end());
+            expectSame(flowshop_ext::mergeNaiveShards(jobs, ui, m, U, records), ref, n,
+                       "mergeNaiveShards (K = " + std::to_string(K) + ")");
+            ++shardMerges;
+        }
+    }
+
+    // Approximate DP on costs large enough for K > 1. With the default
+    // exactCellLimit these instances are cheap, so the result must never be
+    // worse than solveDP; with exactCellLimit = 0 (grid only) no factor is
+    // promised, and how far it falls behind is only reported.
+    const double epsilons[] = {0.1, 0.25, 0.5};
+    int approxChecked = 0, gridWorse = 0;
+    double gridWorstRatio = 1.0;
+    for (int rep = 0; rep < 1500; ++rep) {
+        const int n = std::uniform_int_distribution<int>(1, 12)(rng);
+        const int m = distM(rng);
+        std::uniform_int_distribution<int> distPW(1, 20);
+        std::uniform_int_distribution<int> distCost(1, 60);
+        std::vector<flowshop::Job> jobs;
+        std::vector<int> ui;
+        for (int i = 0; i < n; ++i) {
+            jobs.push_back(flowshop::Job{i, distPW(rng), distPW(rng)});
+            ui.push_back(distCost(rng));
+        }
+        const int total = std::accumulate(ui.begin(), ui.end(), 0);
+        const int U = std::uniform_int_distribution<int>(0, total)(rng);
+        const double epsilon = epsilons[rep % 3];
+
+        const long long optimum = flowshop_ext::solveNaiveDetailed(jobs, ui, m, U).objective;
+        const long long dp = flowshop_ext::solveDP(jobs, ui, m, U).objective;
+        for (long long limit : {flowshop_ext::kApproxExactCells, 0LL}) {
+            flowshop_ext::ApproxDPReport report;
+            const flowshop_ext::NaiveResult approx =
+                flowshop_ext::solveDPApprox(jobs, ui, m, U, epsilon, &report, limit);
+            if (approx.outsourcingCost > U) fail("solveDPApprox goes over budget", rep);
+            if (approx.objective < optimum) fail("solveDPApprox beats the naive optimum", rep);
+            if (report.lowerBound > optimum) fail("outsourcingLowerBound is above the naive optimum", rep);
+            const double gap = approx.objective == 0 ? 0.0
+                : static_cast<double>(approx.objective - report.lowerBound) / static_cast<double>(approx.objective);
+            if (report.gap < 0.0 || report.gap > 1.0 || std::abs(report.gap - gap) > 1e-12) {
+                fail("solveDPApprox gap does not match its objective and lower bound", rep);
+            }
+            if (limit > 0) {
+                if (!report.exactDP) fail("solveDPApprox skipped the exact DP on a cheap instance", rep);
+                if (approx.objective > dp) fail("solveDPApprox with the exact DP is worse than solveDP", rep);
+            } else if (approx.objective > dp) {
+                ++gridWorse;
+                gridWorstRatio = std::max(gridWorstRatio, dp == 0 ? static_cast<double>(approx.objective) + 1.0
+                                                                  : static_cast<double>(approx.objective) / dp);
+            }
+        }
+        ++approxChecked;
+    }
+
+    std::uniform_int_distribution<int> distSmall(0, 2);
+
+    // Past the naive walk's 62 jobs with p = 0 present (no branch and bound),
+    // the DP is the last stage: a finished DP is a completed anytime solve.
+    for (int rep = 0; rep < 20; ++rep) {
+        const int n = 63 + rep;
+        std::uniform_int_distribution<int> distP(0, 5);
+        std::vector<flowshop::Job> jobs;
+        std::vector<int> ui;
+        for (int i = 0; i < n; ++i) {
+            jobs.push_back(flowshop::Job{i, i == 0 ? 0 : distP(rng), distSmall(rng)});
+            ui.push_back(distU(rng));
+        }
+        const int U = 2 * n;
+        const flowshop_ext::AnytimeResult anytime =
+            flowshop_ext::solveAnytime(jobs, ui, 3, U, flowshop_ext::CancelToken{});
+        if (!anytime.completed || anytime.provenOptimal) {
+            fail("solveAnytime past 62 jobs without branch and bound is not a completed DP solve", rep);
+        }
+        if (anytime.result.objective > flowshop_ext::solveDP(jobs, ui, 3, U).objective) {
+            fail("solveAnytime past 62 jobs is worse than solveDP", rep);
+        }
+    }
+
+    // Reduction: even reps draw jobs from a few (p, w) values, p = w = 0
+    // included, with costs that are multiples of a common factor and some
+    // above any budget, so every rule of reduceInstance fires (checked below).
+    // Odd reps use distinct positive jobs and a budget above every cost, so
+    // the reduction only caps and scales the budget: there solveDPReduced
+    // runs solveDP's recurrence and must return solveDP's result. Elsewhere
+    // its rows see other sets than solveDP's, so they are only compared.
+    std::uniform_int_distribution<int> distCopies(0, 3);
+    const int costFactors[] = {1, 2, 3, 6};
+    long long forcedByBudget = 0, forcedZero = 0, merged = 0, scaled = 0;
+    int reduced = 0, dpMatched = 0, dpBetter = 0, dpWorse = 0;
+    for (int rep = 0; rep < 2000; ++rep) {
+        const bool distinct = rep % 2 == 1;
+        const int n = distN(rng);
+        const int m = distM(rng);
+        const int factor = costFactors[distCopies(rng)];
+        std::uniform_int_distribution<int> distPW(1, 1000);
+        std::vector<flowshop::Job> jobs;
+        std::vector<int> ui;
+        for (int i = 0; i < n; ++i) {
+            if (distinct) {
+                jobs.push_back(flowshop::Job{i, distPW(rng), distPW(rng)});
+                ui.push_back(factor * (1 + distCopies(rng)));
+            } else {
+                jobs.push_back(flowshop::Job{i, distSmall(rng), distSmall(rng)});
+                ui.push_back(factor * (distCopies(rng) == 0 ? 20 : distCopies(rng)));
+            }
+        }
+        const int total = std::accumulate(ui.begin(), ui.end(), 0);
+        const int maxCost = ui.empty() ? 0 : *std::max_element(ui.begin(), ui.end());
+        const int U = distinct ? std::uniform_int_distribution<int>(maxCost, total + factor)(rng)
+                               : std::uniform_int_distribution<int>(0, std::min(total, 12 * factor))(rng);
+
+        const flowshop_ext::InstanceReduction reduction = flowshop_ext::reduceInstance(jobs, ui, U);
+        forcedByBudget += reduction.forcedByBudget;
+        forcedZero += reduction.forcedZero;
+        merged += reduction.mergedJobs;
+        if (reduction.costScale > 1) ++scaled;
+
+        const flowshop_ext::NaiveResult ref = flowshop_ext::solveNaiveDetailed(jobs, ui, m, U);
+        const flowshop_ext::NaiveResult naive = flowshop_ext::solveNaiveReduced(jobs, ui, m, reduction);
+        const flowshop_ext::NaiveResult dp = flowshop_ext::solveDPReduced(jobs, ui, m, reduction);
+        if (naive.objective != ref.objective) fail("solveNaiveReduced objective differs from naive", rep);
+        if (naive.outsourcingCost > U) fail("solveNaiveReduced goes over budget", rep);
+        if (dp.outsourcingCost > U) fail("solveDPReduced goes over budget", rep);
+        const flowshop_ext::NaiveResult direct = flowshop_ext::solveDP(jobs, ui, m, U);
+        if (reduction.fixedInhouse.empty() && reduction.mergedJobs == 0) {
+            if (dp.objective != direct.objective || inhouseMask(dp, n) != inhouseMask(direct, n)) {
+                fail("solveDPReduced differs from solveDP with nothing fixed or merged", rep);
+            }
+            ++dpMatched;
+        } else if (dp.objective < direct.objective) {
+            ++dpBetter;
+        } else if (dp.objective > direct.objective) {
+            ++dpWorse;
+        }
+        ++reduced;
+    }
+    if (dpMatched == 0) throw std::runtime_error("Exact check failed: no reduction left solveDP's rows intact");
+    if (forcedByBudget == 0 || forcedZero == 0 || merged == 0 || scaled == 0) {
+        throw std::runtime_error("Exact check failed: the reduction instances miss a reduction rule");
+    }
+
+    std::cout << "Exact check: " << checked
+              << " (instance, budget) pairs, GrayCode and SplitHalf naive and solveBranchAndBound match "
+                 "Ascending naive (objective and in-house mask); solveNaiveParallel (4 chunk sizes) and "
+              << shardMerges << " shard merges match solveNaiveDetailed, records round-trip; "
+                 "solveAnytime without a deadline completes, and every anytime solver cut short by a fired "
+                 "token returns a feasible, uncompleted result\n";
+    std::cout << "Pareto check: solveDPPareto stays within U with its in-house order's objective; against "
+                 "solveDP better on " << paretoBetter << " and worse on " << paretoWorse << " of " << checked << "\n";
+    std::cout << "Curve check: " << curveBudgets << " budgets, DPBudgetCurve::dpObjectiveAt matches solveDP, "
+                 "objectiveAt is non-increasing, resultAt fits its budget on the curve\n";
+    std::cout << "Approx check: " << approxChecked << " instances, solveDPApprox stays within U, above "
+                 "outsourcingLowerBound with a consistent gap, never worse than solveDP when the exact DP is "
+                 "cheap (grid only: worse on " << gridWorse << ", worst ratio " << gridWorstRatio << ")\n";
+    std::cout << "Reduction check: " << reduced << " instances (" << forcedByBudget << " jobs forced by u > U, "
+              << forcedZero << " p = w = 0, " << merged << " merged copies, " << scaled
+              << " gcd-scaled), solveNaiveReduced matches naive, both reduced solvers stay within U; "
+                 "solveDPReduced matches solveDP on " << dpMatched << " with nothing fixed or merged, "
+                 "elsewhere better on " << dpBetter << " and worse on " << dpWorse << "\n";
+}
+
+// Local-search mode: one random job set of --ls-n jobs, the plain WSPT-MCI
+// sequence, a single local search on it, and --local-search starts (over
+// --threads threads) within --ls-ms milliseconds (0 = no limit).
+static void runLocalSearch(unsigned int seed, int n, int starts, int timeMs, int threads) {
+    std::mt19937 rng(seed);
+    std::uniform_int_distribution<int> distPW(1, 100);
+    std::vector<flowshop::Job> jobs;
+    jobs.reserve(n);
+    for (int i = 0; i < n; ++i) jobs.push_back(flowshop::Job{i, distPW(rng), distPW(rng)});
+    const int m = 5;
+
+    flowshop::LocalSearchOptions options;
+    options.starts = starts;
+    options.seed = seed;
+    options.timeLimit = std::chrono::milliseconds(timeMs);
+
+    flowshop::Solution mci;
+    const long long mciUs = measureMicroseconds([&]() { mci = flowshop::solveWSPT_MCI(jobs, m, false); });
+
+    flowshop::LocalSearchStats single;
+    flowshop::Solution improved;
+    const long long singleUs = measureMicroseconds([&]() {
+        improved = flowshop::improveSolution(mci, m, options, &single);
+    });
+
+    flowshop::LocalSearchStats multi;
+    flowshop::Solution best;
+    const long long multiUs = measureMicroseconds([&]() {
+        if (threads > 1) {
+            flowshop_ext::WorkStealingPool pool(threads);
+            best = flowshop_ext::solveWSPT_MCI_LocalSearchParallel(jobs, m, options, pool, &multi);
+        } else {
+            best = flowshop::solveWSPT_MCI_LocalSearch(jobs, m, options, &multi);
+        }
+    });
+
+    std::cout << "Jobs: " << n << ", m = " << m << "\n";
+    std::cout << "WSPT-MCI:      " << mci.objective << " (" << mciUs / 1000.0 << " ms)\n";
+    std::cout << "Local search:  " << improved.objective << " (" << singleUs / 1000.0 << " ms, "
+              << single.passes << " passes, " << single.movesApplied << " / " << single.movesEvaluated
+              << " moves applied)\n";
+    std::cout << "Multi-start:   " << best.objective << " (" << multiUs / 1000.0 << " ms, "
+              << multi.starts << " starts, " << threads << " threads"
+              << (multi.timedOut ? ", time limit hit" : "") << ")\n";
+}
+
+// Shard mode: every process rebuilds the same instance from --seed and
+// --shard-n, solves its slice of the naive mask space and prints one record;
+// --merge-shards reads the records back (file or "-" for stdin) and prints
+// the final result.
+static RandomInstance shardInstance(unsigned int seed, int n) {
+    InstanceParams params;
+    params.nMin = params.nMax = n;
+    std::mt19937 rng(seed);
+    return generateRandomInstance(rng, params);
+}
+
+static void runNaiveShard(unsigned int seed, int n, int shard, int shardCount, int threads) {
+    const RandomInstance inst = shardInstance(seed, n);
+    flowshop_ext::WorkStealingPool pool(threads);
+    const flowshop_ext::NaiveShardRecord record = flowshop_ext::solveNaiveShard(
+        inst.jobs, inst.ui, inst.m, inst.U, shard, shardCount, pool);
+    flowshop_ext::writeShardRecord(std::cout, record);
+}
+
+static void runMergeShards(unsigned int seed, int n, const std::string& path) {
+    std::ifstream file;
+    if (path != "-") {
+        file.open(path);
+        if (!file) throw std::runtime_error("cannot open " + path);
+    }
+    std::istream& in = path == "-" ? std::cin : file;
+
+    std::vector<flowshop_ext::NaiveShardRecord> records;
+    flowshop_ext::NaiveShardRecord record;
+    while (flowshop_ext::readShardRecord(in, record)) records.push_back(record);
+
+    const RandomInstance inst = shardInstance(seed, n);
+    printInstanceSummary(inst);
+    std::cout << "\nMerged " << records.size() << " shard records\n";
+    printNaiveResult(flowshop_ext::mergeNaiveShards(inst.jobs, inst.ui, inst.m, inst.U, records), inst.U);
+}
+
+static void parseShard(const std::string& text, int& shard, int& shardCount) {
+    const size_t slash = text.find('/');
+    if (slash == std::string::npos) throw std::invalid_argument("--shard expects k/K");
+    shard = std::stoi(text.substr(0, slash));
+    shardCount = std::stoi(text.substr(slash + 1));
+}
+
+struct RunOptions {
+    bool checkEngines = false;
+    bool checkIncremental = false;
+    bool checkVerify = false;
+    bool checkExact = false;
+    bool sweep = false;
+    int batchCount = 0;
+    int threads = 1;
+    SweepOptions sweepOpts;
+    int shard = -1;
+    int shardCount = 0;
+    int shardN = 30;
+    std::string mergePath;
+    std::string writeInstancesPath;
+    std::string batchFilePath;
+    int localSearchStarts = 0;
+    int localSearchN = 200;
+    int localSearchMs = 0;
+};
+
+static RunOptions parseOptions(int argc, char** argv) {
+    RunOptions opts;
+    for (int i = 1; i < argc; ++i) {
+        const std::string arg = argv[i];
+        if (arg == "--check-engines") {
+            opts.checkEngines = true;
+        } else if (arg == "--check-incremental") {
+            opts.checkIncremental = true;
+        } else if (arg == "--check-verify") {
+            opts.checkVerify = true;
+        } else if (arg == "--check-exact") {
+            opts.checkExact = true;
+        } else if (arg == "--bench" && i + 1 < argc) {
+            const std::string format = argv[++i];
+            if (format != "csv" && format != "json") {
+                throw std::invalid_argument("--bench expects csv or json");
+            }
+            opts.sweep = true;
+            opts.sweepOpts.json = format == "json";
+        } else if (arg == "--bench-n" && i + 1 < argc) {
+            opts.sweepOpts.nValues = parseIntList(argv[++i]);
+        } else if (arg == "--bench-m" && i + 1 < argc) {
+            opts.sweepOpts.mValues = parseIntList(argv[++i]);
+        } else if (arg == "--bench-u" && i + 1 < argc) {
+            opts.sweepOpts.budgetCaps = parseIntList(argv[++i]);
+        } else if (arg == "--bench-eps" && i + 1 < argc) {
+            opts.sweepOpts.approxEpsilon = std::stod(argv[++i]);
+        } else if (arg == "--warmup" && i + 1 < argc) {
+            opts.sweepOpts.warmup = std::max(0, std::stoi(argv[++i]));
+        } else if (arg == "--repeats" && i + 1 < argc) {
+            opts.sweepOpts.repeats = std::max(1, std::stoi(argv[++i]));
+        } else if (arg == "--seed" && i + 1 < argc) {
+            opts.sweepOpts.seed = static_cast<unsigned int>(std::stoul(argv[++i]));
+        } else if (arg == "--batch" && i + 1 < argc) {
+            opts.batchCount = std::stoi(argv[++i]);
+        } else if (arg == "--shard" && i + 1 < argc) {
+            parseShard(argv[++i], opts.shard, opts.shardCount);
+        } else if (arg == "--shard-n" && i + 1 < argc) {
+            opts.shardN = std::stoi(argv[++i]);
+        } else if (arg == "--merge-shards" && i + 1 < argc) {
+            opts.mergePath = argv[++i];
+        } else if (arg == "--write-instances" && i + 1 < argc) {
+            opts.writeInstancesPath = argv[++i];
+        } else if (arg == "--batch-file" && i + 1 < argc) {
+            opts.batchFilePath = argv[++i];
+        } else if (arg == "--local-search" && i + 1 < argc) {
+            opts.localSearchStarts = std::max(1, std::stoi(argv[++i]));
+        } else if (arg == "--ls-n" && i + 1 < argc) {
+            opts.localSearchN = std::max(1, std::stoi(argv[++i]));
+        } else if (arg == "--ls-ms" && i + 1 < argc) {
+            opts.localSearchMs = std::max(0, std::stoi(argv[++i]));
+        } else if (arg == "--threads" && i + 1 < argc) {
+            opts.threads = std::stoi(argv[++i]);
+            if (opts.threads <= 0) {
+                opts.threads = static_cast<int>(std::max(1u, std::thread::hardware_concurrency()));
+            }
+        } else {
+            throw std::invalid_argument("unknown option: " + arg);
+        }
+    }
+    return opts;
+}
+
+int main(int argc, char** argv) {
     try {
-        runRandomDemoOnce();
+        const RunOptions opts = parseOptions(argc, argv);
+        if (opts.checkEngines) {
+            runEngineCheck();
+            return 0;
+        }
+        if (opts.checkIncremental) {
+            runIncrementalCheck();
+            return 0;
+        }
+        if (opts.checkVerify) {
+            runVerifySamplerCheck();
+            return 0;
+        }
+        if (opts.checkExact) {
+            runExactCheck();
+            return 0;
+        }
+        if (opts.sweep) {
+            SweepOptions sweepOpts = opts.sweepOpts;
+            sweepOpts.threads = opts.threads;
+            runBenchmarkSweep(sweepOpts);
+            return 0;
+        }
+        if (opts.shardCount > 0) {
+            runNaiveShard(opts.sweepOpts.seed, opts.shardN, opts.shard, opts.shardCount, opts.threads);
+            return 0;
+        }
+        if (!opts.mergePath.empty()) {
+            runMergeShards(opts.sweepOpts.seed, opts.shardN, opts.mergePath);
+            return 0;
+        }
+        if (!opts.writeInstancesPath.empty()) {
+            runWriteInstances(opts.writeInstancesPath, std::max(opts.batchCount, 1), opts.sweepOpts.seed);
+            return 0;
+        }
+        if (!opts.batchFilePath.empty()) {
+            runBatchFile(opts.batchFilePath, opts.threads);
+            return 0;
+        }
+        if (opts.localSearchStarts > 0) {
+            runLocalSearch(opts.sweepOpts.seed, opts.localSearchN, opts.localSearchStarts,
+                           opts.localSearchMs, opts.threads);
+            return 0;
+        }
+        if (opts.batchCount > 0) {
+            runBatchDemo(opts.batchCount, opts.threads);
+            return 0;
+        }
+
+        runRandomDemoOnce(opts.threads);
         return 0;
     } catch (const std::exception& ex) {
         std::cerr << "\nFatal error: " << ex.what() << std::endl;